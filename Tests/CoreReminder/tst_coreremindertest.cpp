@@ -3,9 +3,16 @@
 #include <QCoreApplication>
 #include <QtMvvmCore>
 #include <QtDataSync>
+#include <QJsonSerializer>
 
 #include <schedule.h>
 #include <eventexpressionparser.h>
+#include <reminderindex.h>
+#include <reminderbatch.h>
+#include <reminderwritebuffer.h>
+#include <conflictresolver.h>
+#include <libsyrem.h>
+#include <algorithm>
 
 class CoreReminderTest : public QObject
 {
@@ -27,9 +34,23 @@ private Q_SLOTS:
 	void testConjunctionReminder_data();
 	void testConjunctionReminder();
 
+	void testReminderIndex_data();
+	void testReminderIndex();
+	void testReminderIndexReconcile();
+
+	void testReminderBatch();
+	void testReminderWriteBuffer();
+	void testConflictResolver_data();
+	void testConflictResolver();
+	void testConflictResolverSchedules();
+	void benchmarkConflictResolver_data();
+	void benchmarkConflictResolver();
+
 private:
 	QTemporaryDir tDir;
 	EventExpressionParser *parser;
+
+	static Reminder createConflict(const QUuid &id, const QDateTime &due, const QList<QDateTime> &snoozes);
 };
 
 void CoreReminderTest::initTestCase()
@@ -1549,6 +1570,498 @@ void CoreReminderTest::testConjunctionReminder()
 	}
 }
 
+void CoreReminderTest::testReminderIndex_data()
+{
+	QTest::addColumn<QList<QDateTime>>("dues");
+	QTest::addColumn<QList<QDateTime>>("snoozes");
+	QTest::addColumn<QDateTime>("from");
+	QTest::addColumn<QDateTime>("to");
+	QTest::addColumn<QList<int>>("before");
+	QTest::addColumn<QList<int>>("between");
+
+	QTest::newRow("empty") << QList<QDateTime>{}
+						   << QList<QDateTime>{}
+						   << QDateTime({2017, 10, 24})
+						   << QDateTime({2017, 10, 25})
+						   << QList<int>{}
+						   << QList<int>{};
+	QTest::newRow("ordered") << QList<QDateTime> {
+									QDateTime({2017, 10, 26}, {10, 00}),
+									QDateTime({2017, 10, 24}, {10, 00}),
+									QDateTime({2017, 10, 25}, {10, 00}),
+									QDateTime({2017, 10, 23}, {10, 00})
+								}
+							 << QList<QDateTime>{}
+							 << QDateTime({2017, 10, 24})
+							 << QDateTime({2017, 10, 26})
+							 << QList<int>{3, 1, 2}
+							 << QList<int>{1, 2};
+	QTest::newRow("bounds") << QList<QDateTime> {
+								   QDateTime({2017, 10, 24}, {12, 00}),
+								   QDateTime({2017, 10, 24}, {10, 00}),
+								   QDateTime({2017, 10, 24}, {11, 00})
+							   }
+							<< QList<QDateTime>{}
+							<< QDateTime({2017, 10, 24}, {10, 00})
+							<< QDateTime({2017, 10, 24}, {12, 00})
+							<< QList<int>{1, 2}
+							<< QList<int>{1, 2};
+	QTest::newRow("sameTime") << QList<QDateTime> {
+									 QDateTime({2017, 10, 24}, {10, 00}),
+									 QDateTime({2017, 10, 24}, {10, 00})
+								 }
+							  << QList<QDateTime>{}
+							  << QDateTime({2017, 10, 24})
+							  << QDateTime({2017, 10, 25})
+							  << QList<int>{0, 1}
+							  << QList<int>{0, 1};
+	QTest::newRow("unscheduled") << QList<QDateTime> {
+										QDateTime(),
+										QDateTime({2017, 10, 24}, {10, 00})
+									}
+								 << QList<QDateTime>{}
+								 << QDateTime({2017, 10, 24})
+								 << QDateTime({2017, 10, 25})
+								 << QList<int>{1}
+								 << QList<int>{1};
+	QTest::newRow("snoozed") << QList<QDateTime> {
+									QDateTime({2017, 10, 24}, {10, 00}),
+									QDateTime({2017, 10, 24}, {11, 00})
+								}
+							 << QList<QDateTime> {
+									QDateTime({2017, 10, 26}, {10, 00}),
+									QDateTime()
+								}
+							 << QDateTime({2017, 10, 24})
+							 << QDateTime({2017, 10, 25})
+							 << QList<int>{1}
+							 << QList<int>{1};
+}
+
+void CoreReminderTest::testReminderIndex()
+{
+	QFETCH(QList<QDateTime>, dues);
+	QFETCH(QList<QDateTime>, snoozes);
+	QFETCH(QDateTime, from);
+	QFETCH(QDateTime, to);
+	QFETCH(QList<int>, before);
+	QFETCH(QList<int>, between);
+
+	QtDataSync::DataStore store;
+	QList<Reminder> reminders;
+	for(auto i = 0; i < dues.size(); ++i) {
+		Reminder reminder;
+		reminder.setId(QUuid::createUuid());
+		if(dues[i].isValid())
+			reminder.setSchedule(QSharedPointer<OneTimeSchedule>::create(dues[i], dues[i]));
+		if(i < snoozes.size() && snoozes[i].isValid())
+			reminder.performSnooze(&store, snoozes[i]);
+		reminders.append(reminder);
+	}
+
+	ReminderIndex index;
+	index.reset(reminders);
+	QCOMPARE(index.size(), reminders.size());
+
+	auto ids = [&](const QList<int> &indexes) {
+		QList<QUuid> res;
+		for(auto i : indexes)
+			res.append(reminders[i].id());
+		return res;
+	};
+	auto idsOf = [](const QList<Reminder> &reminders) {
+		QList<QUuid> res;
+		for(const auto &reminder : reminders)
+			res.append(reminder.id());
+		return res;
+	};
+
+	// reminders with the same time may be in any order
+	const auto dueBefore = index.dueBefore(to);
+	QCOMPARE(idsOf(dueBefore).toSet(), ids(before).toSet());
+	QVERIFY(std::is_sorted(dueBefore.begin(), dueBefore.end(), [](const Reminder &lhs, const Reminder &rhs) {
+		return lhs.current() < rhs.current();
+	}));
+	QCOMPARE(idsOf(index.dueBetween(from, to)).toSet(), ids(between).toSet());
+	const auto dueReminders = index.dueReminders();
+	QVERIFY(std::is_sorted(dueReminders.begin(), dueReminders.end(), [](const Reminder &lhs, const Reminder &rhs) {
+		return lhs.current() < rhs.current();
+	}));
+	QCOMPARE(index.hasDue(), !dueReminders.isEmpty());
+	if(index.hasDue())
+		QCOMPARE(index.nextDue().current(), dueReminders.first().current());
+	if(!before.isEmpty())
+		QCOMPARE(index.nextDue().current(), dueBefore.first().current());
+
+	// incremental changes keep the order
+	for(const auto &reminder : qAsConst(reminders)) {
+		QVERIFY(index.remove(reminder.id()));
+		QVERIFY(!index.contains(reminder.id()));
+		index.insert(reminder);
+	}
+	QCOMPARE(idsOf(index.dueBefore(to)).toSet(), ids(before).toSet());
+	for(const auto &reminder : qAsConst(reminders))
+		QVERIFY(index.remove(reminder.id()));
+	QCOMPARE(index.size(), 0);
+	QVERIFY(index.dueBefore(to).isEmpty());
+}
+
+void CoreReminderTest::testReminderIndexReconcile()
+{
+	const QDateTime due {{2030, 1, 1}, {12, 0}};
+	QList<Reminder> reminders;
+	for(auto i = 0; i < 4; ++i)
+		reminders.append(createConflict(QUuid::createUuid(), due.addDays(i), {}));
+
+	ReminderIndex index;
+	index.reset(reminders.mid(0, 3));
+
+	// 0 stays, 1 is updated, 2 is removed and 3 is added
+	auto updated = reminders[1];
+	updated.applySnooze(due.addDays(10));
+	const auto changes = index.reconcile({reminders[0], updated, reminders[3]});
+	QCOMPARE(changes.added.size(), 1);
+	QCOMPARE(changes.added.first().id(), reminders[3].id());
+	QCOMPARE(changes.updated.size(), 1);
+	QCOMPARE(changes.updated.first().id(), updated.id());
+	QCOMPARE(changes.removed, QList<QUuid>{reminders[2].id()});
+	QVERIFY(!changes.isEmpty());
+
+	QCOMPARE(index.size(), 3);
+	QVERIFY(!index.contains(reminders[2].id()));
+	QCOMPARE(index.reminder(updated.id()).versionCode(), updated.versionCode());
+	QCOMPARE(index.nextDue().id(), reminders[0].id());
+	QCOMPARE(index.dueBefore(due.addDays(5)).size(), 2);
+
+	// nothing changed anymore
+	QVERIFY(index.reconcile({reminders[0], updated, reminders[3]}).isEmpty());
+
+	// unknown versions are always added
+	const auto diff = ReminderIndex::diff({}, reminders);
+	QCOMPARE(diff.added.size(), reminders.size());
+	QVERIFY(diff.updated.isEmpty());
+	QVERIFY(diff.removed.isEmpty());
+}
+
+void CoreReminderTest::testReminderBatch()
+{
+	try {
+		ReminderStore store;
+		ReminderBatch batch{&store};
+		// store signals the written signal already covered, and all others
+		auto covered = 0;
+		auto changes = 0;
+		connect(&store, &QtDataSync::DataTypeStoreBase::dataChanged, this, [&](const QString &key, const QVariant &value) {
+			if(batch.wasWritten(key, value))
+				covered++;
+			else
+				changes++;
+		});
+
+		const auto since = QDateTime({2017, 10, 24}, {15, 00});
+		auto createReminder = [&](const QString &query) {
+			Reminder reminder;
+			reminder.setId(QUuid::createUuid());
+			reminder.setSchedule(parser->createMultiSchedule(parser->parseMultiExpression(query), {}, since));
+			store.save(reminder);
+			return reminder;
+		};
+		const auto repeated = createReminder(QStringLiteral("every 2 days at 19:45"));
+		const auto single = createReminder(QStringLiteral("on 11.11.2017 at 11:11"));
+		const auto other = createReminder(QStringLiteral("every Thursday at 18:00"));
+		QTRY_COMPARE(changes, 3);
+
+		auto writeCount = 0;
+		QList<Reminder> saved;
+		QList<QUuid> removed;
+		connect(&batch, &ReminderBatch::written, this, [&](const QList<Reminder> &s, const QList<QUuid> &r) {
+			writeCount++;
+			saved = s;
+			removed = r;
+		});
+
+		// repeated reminders move on, the others are deleted
+		batch.complete({repeated, single}, since);
+		QCOMPARE(writeCount, 1);
+		QCOMPARE(saved.size(), 1);
+		QCOMPARE(saved.first().id(), repeated.id());
+		QVERIFY(saved.first().due() > repeated.due());
+		QCOMPARE(store.load(repeated.id()).due(), saved.first().due());
+		QCOMPARE(removed, QList<QUuid>{single.id()});
+		QVERIFY_EXCEPTION_THROWN(store.load(single.id()), QtDataSync::NoDataException);
+		QTRY_COMPARE(covered, 2);
+
+		// one invalid snooze means nothing is written
+		QVERIFY_EXCEPTION_THROWN(batch.snooze({other, saved.first()}, since), EventExpressionParserException);
+		QCOMPARE(writeCount, 1);
+		QCOMPARE(store.load(other.id()).versionCode(), other.versionCode());
+
+		const auto snooze = QDateTime({2030, 1, 1}, {12, 00});
+		batch.snooze({other, saved.first()}, snooze);
+		QCOMPARE(writeCount, 2);
+		QCOMPARE(saved.size(), 2);
+		QVERIFY(removed.isEmpty());
+		QCOMPARE(store.load(other.id()).snooze(), snooze);
+		QCOMPARE(store.load(repeated.id()).snooze(), snooze);
+		QTRY_COMPARE(covered, 4);
+
+		// changes from elsewhere are not covered, even for reminders written before
+		auto edited = store.load(repeated.id());
+		edited.setDescription(QStringLiteral("edited"));
+		store.save(edited);
+		QTRY_COMPARE(changes, 4);
+
+		// already deleted ones are skipped
+		batch.remove({other.id(), single.id()});
+		QCOMPARE(writeCount, 3);
+		QVERIFY(saved.isEmpty());
+		QCOMPARE(removed, QList<QUuid>{other.id()});
+		QVERIFY_EXCEPTION_THROWN(store.load(other.id()), QtDataSync::NoDataException);
+		QTRY_COMPARE(covered, 5);
+		QVERIFY(store.remove(repeated.id()));
+		QTRY_COMPARE(changes, 5);
+		QCOMPARE(covered, 5);
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void CoreReminderTest::testReminderWriteBuffer()
+{
+	try {
+		ReminderStore store;
+		auto changes = 0;
+		connect(&store, &QtDataSync::DataTypeStoreBase::dataChanged, this, [&]() {
+			changes++;
+		});
+
+		const auto since = QDateTime({2017, 10, 24}, {15, 00});
+		Reminder reminder;
+		reminder.setId(QUuid::createUuid());
+		reminder.setSchedule(parser->createMultiSchedule(parser->parseMultiExpression(QStringLiteral("every 2 days at 19:45")), {}, since));
+		store.save(reminder);
+		QTRY_COMPARE(changes, 1);
+
+		QScopedPointer<ReminderWriteBuffer> buffer{new ReminderWriteBuffer{}};
+		buffer->setDelay(std::chrono::hours{1});
+		reminder.performSnooze(buffer.data(), QDateTime({2030, 1, 1}, {12, 00}));
+		reminder.performSnooze(buffer.data(), QDateTime({2030, 1, 2}, {12, 00}));
+		reminder.nextSchedule(buffer.data(), since);
+		QVERIFY(buffer->isPending(reminder.id()));
+		QCOMPARE(store.load(reminder.id()).versionCode(), 1u);
+
+		// three changes, one write
+		buffer->flush();
+		QVERIFY(!buffer->hasPending());
+		QTRY_COMPARE(changes, 2);
+		QCOMPARE(store.load(reminder.id()).versionCode(), reminder.versionCode());
+		QCOMPARE(store.load(reminder.id()).due(), reminder.due());
+
+		// after a reload, only writes newer than the stored data stay
+		auto outdated = reminder;
+		outdated.applySnooze(QDateTime({2030, 1, 3}, {12, 00}));
+		buffer->save(outdated);
+		auto stored = outdated;
+		stored.applySnooze(QDateTime({2030, 1, 4}, {12, 00}));
+		buffer->discardOutdated({stored}, {});
+		QVERIFY(!buffer->hasPending());
+		buffer->save(stored);
+		buffer->discardOutdated({outdated}, {});
+		QVERIFY(buffer->isPending(reminder.id()));
+		buffer->discardOutdated({}, {reminder.id()});
+		QVERIFY(!buffer->hasPending());
+		QCOMPARE(store.load(reminder.id()).versionCode(), reminder.versionCode());
+
+		// destroying the buffer writes the rest
+		buffer->remove(reminder.id());
+		QVERIFY(buffer->isPending(reminder.id()));
+		buffer.reset();
+		QVERIFY_EXCEPTION_THROWN(store.load(reminder.id()), QtDataSync::NoDataException);
+
+		// without a delay, nothing is buffered
+		ReminderWriteBuffer directBuffer;
+		directBuffer.save(reminder);
+		QVERIFY(!directBuffer.hasPending());
+		QCOMPARE(store.load(reminder.id()).versionCode(), reminder.versionCode());
+		QVERIFY(store.remove(reminder.id()));
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void CoreReminderTest::testConflictResolver_data()
+{
+	QTest::addColumn<QDateTime>("due1");
+	QTest::addColumn<QList<QDateTime>>("snoozes1");
+	QTest::addColumn<QDateTime>("due2");
+	QTest::addColumn<QList<QDateTime>>("snoozes2");
+	QTest::addColumn<int>("resolution");
+
+	const QDateTime due {{2030, 1, 1}, {12, 0}};
+	QTest::addRow("equal") << due << QList<QDateTime>{}
+						   << due << QList<QDateTime>{}
+						   << static_cast<int>(ConflictResolver::NoResolution);
+	QTest::addRow("version") << due << QList<QDateTime>{}
+							 << due << QList<QDateTime>{due.addDays(1)}
+							 << static_cast<int>(ConflictResolver::SecondWins);
+	QTest::addRow("version.due") << due.addDays(5) << QList<QDateTime>{due.addDays(7), due.addDays(8)}
+								 << due << QList<QDateTime>{due.addDays(1)}
+								 << static_cast<int>(ConflictResolver::FirstWins);
+	QTest::addRow("snooze") << due << QList<QDateTime>{due.addDays(1)}
+							<< due << QList<QDateTime>{due.addDays(2)}
+							<< static_cast<int>(ConflictResolver::FirstWins);
+	QTest::addRow("snooze.due") << due.addDays(-1) << QList<QDateTime>{due.addDays(3)}
+								<< due << QList<QDateTime>{due.addDays(2)}
+								<< static_cast<int>(ConflictResolver::SecondWins);
+	QTest::addRow("due") << due << QList<QDateTime>{}
+						 << due.addSecs(60) << QList<QDateTime>{}
+						 << static_cast<int>(ConflictResolver::SecondWins);
+}
+
+void CoreReminderTest::testConflictResolver()
+{
+	QFETCH(QDateTime, due1);
+	QFETCH(QList<QDateTime>, snoozes1);
+	QFETCH(QDateTime, due2);
+	QFETCH(QList<QDateTime>, snoozes2);
+	QFETCH(int, resolution);
+
+	const auto id = QUuid::createUuid();
+	const auto data1 = createConflict(id, due1, snoozes1);
+	const auto data2 = createConflict(id, due2, snoozes2);
+
+	QCOMPARE(static_cast<int>(ConflictResolver::resolve(data1, data2)), resolution);
+	QCOMPARE(static_cast<int>(ConflictResolver::resolve(ConflictResolver::Metadata::of(data1), ConflictResolver::Metadata::of(data2))),
+			 resolution);
+	// the order of the arguments must not matter
+	auto swapped = static_cast<ConflictResolver::Resolution>(resolution);
+	if(swapped == ConflictResolver::FirstWins)
+		swapped = ConflictResolver::SecondWins;
+	else if(swapped == ConflictResolver::SecondWins)
+		swapped = ConflictResolver::FirstWins;
+	QCOMPARE(ConflictResolver::resolve(data2, data1), swapped);
+
+	ConflictResolver resolver;
+	switch(resolution) {
+	case ConflictResolver::FirstWins:
+		QCOMPARE(resolver.resolveConflict(data1, data2, nullptr).versionCode(), data1.versionCode());
+		QCOMPARE(resolver.resolveConflict(data1, data2, nullptr).due(), data1.due());
+		break;
+	case ConflictResolver::SecondWins:
+		QCOMPARE(resolver.resolveConflict(data1, data2, nullptr).versionCode(), data2.versionCode());
+		QCOMPARE(resolver.resolveConflict(data1, data2, nullptr).due(), data2.due());
+		break;
+	default:
+		QVERIFY_EXCEPTION_THROWN(resolver.resolveConflict(data1, data2, nullptr), QtDataSync::NoConflictResultException);
+		break;
+	}
+}
+
+void CoreReminderTest::testConflictResolverSchedules()
+{
+	try {
+		Reminder base;
+		base.setId(QUuid::createUuid());
+		base.setDescription(QStringLiteral("schedules"));
+		base.setSchedule(parser->createMultiSchedule(parser->parseMultiExpression(QStringLiteral("every day at 10:00;every day at 12:00")),
+													  {}, QDateTime({2030, 1, 1}, {9, 0})));
+
+		// same version and due time, but one of the sub schedules moved on further
+		auto advanced = base;
+		QVERIFY(advanced.advanceSchedule(advanced.due()));
+		auto data = Syrem::serializer()->serialize(advanced);
+		data.insert(QStringLiteral("schedule"), Syrem::serializer()->serialize(base).value(QStringLiteral("schedule")));
+		const auto behind = Syrem::serializer()->deserialize<Reminder>(data);
+		QCOMPARE(behind.versionCode(), advanced.versionCode());
+		QCOMPARE(behind.due(), advanced.due());
+
+		// works on the stored data as well as on loaded schedules
+		const auto stored = Syrem::serializer()->deserialize<Reminder>(Syrem::serializer()->serialize(advanced));
+		for(const auto &reminder : {advanced, stored}) {
+			QCOMPARE(ConflictResolver::resolve(reminder, behind), ConflictResolver::FirstWins);
+			QCOMPARE(ConflictResolver::resolve(behind, reminder), ConflictResolver::SecondWins);
+			QCOMPARE(ConflictResolver::resolve(reminder, reminder), ConflictResolver::NoResolution);
+		}
+		behind.scheduleCursor();
+		QCOMPARE(ConflictResolver::resolve(stored, behind), ConflictResolver::FirstWins);
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void CoreReminderTest::benchmarkConflictResolver_data()
+{
+	QTest::addColumn<bool>("metadata");
+
+	QTest::addRow("reminders") << false;
+	QTest::addRow("metadata") << true;
+}
+
+void CoreReminderTest::benchmarkConflictResolver()
+{
+	QFETCH(bool, metadata);
+	constexpr auto ConflictCount = 100000;
+
+	// a quarter of the conflicts each is decided by the version, the snooze, the due time or not at all
+	const QDateTime due {{2030, 1, 1}, {12, 0}};
+	QList<std::pair<Reminder, Reminder>> conflicts;
+	conflicts.reserve(ConflictCount);
+	for(auto i = 0; i < ConflictCount; ++i) {
+		const auto id = QUuid::createUuid();
+		const auto offset = i % 16;
+		switch(i % 4) {
+		case 0: // version
+			conflicts.append({createConflict(id, due, {}), createConflict(id, due, {due.addDays(offset + 1)})});
+			break;
+		case 1: // snooze
+			conflicts.append({createConflict(id, due, {due.addDays(1)}), createConflict(id, due, {due.addDays(offset + 2)})});
+			break;
+		case 2: // due
+			conflicts.append({createConflict(id, due.addSecs(offset), {}), createConflict(id, due.addSecs(offset + 1), {})});
+			break;
+		case 3: // equal
+			conflicts.append({createConflict(id, due, {}), createConflict(id, due, {})});
+			break;
+		default:
+			Q_UNREACHABLE();
+		}
+	}
+
+	QVector<std::pair<ConflictResolver::Metadata, ConflictResolver::Metadata>> metas;
+	if(metadata) {
+		metas.reserve(conflicts.size());
+		for(const auto &conflict : qAsConst(conflicts))
+			metas.append({ConflictResolver::Metadata::of(conflict.first), ConflictResolver::Metadata::of(conflict.second)});
+	}
+
+	auto resolved = 0;
+	QBENCHMARK {
+		resolved = 0;
+		if(metadata) {
+			for(const auto &meta : qAsConst(metas)) {
+				if(ConflictResolver::resolve(meta.first, meta.second) != ConflictResolver::NoResolution)
+					resolved++;
+			}
+		} else {
+			for(const auto &conflict : qAsConst(conflicts)) {
+				if(ConflictResolver::resolve(conflict.first, conflict.second) != ConflictResolver::NoResolution)
+					resolved++;
+			}
+		}
+	}
+	QCOMPARE(resolved, ConflictCount / 4 * 3);
+}
+
+Reminder CoreReminderTest::createConflict(const QUuid &id, const QDateTime &due, const QList<QDateTime> &snoozes)
+{
+	Reminder reminder;
+	reminder.setId(id);
+	reminder.setSchedule(QSharedPointer<OneTimeSchedule>::create(due, due.addYears(-1)));
+	for(const auto &snooze : snoozes)
+		reminder.applySnooze(snooze);
+	return reminder;
+}
+
 QTEST_MAIN(CoreReminderTest)
 
 #include "tst_coreremindertest.moc"
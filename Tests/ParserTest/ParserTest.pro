@@ -1,6 +1,6 @@
 TEMPLATE = app
 
-QT += testlib mvvmcore datasync
+QT += testlib mvvmcore datasync concurrent
 CONFIG += console
 CONFIG -= app_bundle
 
@@ -1,4 +1,6 @@
 #include <QtTest>
+#include <QtConcurrentRun>
+#include <QtConcurrentMap>
 #include <QtMvvmCore>
 #include <QtDataSync>
 #define private public
@@ -8,6 +10,8 @@
 #undef protected
 #undef private
 #include <schedule.h>
+#include <timezoneservice.h>
+#include <ctime>
 using namespace Expressions;
 
 Q_DECLARE_METATYPE(Expressions::SequenceTerm::Sequence)
@@ -80,17 +84,31 @@ private Q_SLOTS:
 
 	void testTermEvaluation_data();
 	void testTermEvaluation();
+	void testTermPrograms_data();
+	void testTermPrograms();
+	void benchmarkTermApply();
+	void testTimeZoneService_data();
+	void testTimeZoneService();
 	void testSingularSchedules_data();
 	void testSingularSchedules();
 	void testRepeatedSchedules_data();
 	void testRepeatedSchedules();
 	void testMultiSchedules_data();
 	void testMultiSchedules();
+	void testScheduleJumps_data();
+	void testScheduleJumps();
+	void testScheduleOccurrences_data();
+	void testScheduleOccurrences();
+	void testScheduleCursors_data();
+	void testScheduleCursors();
+	void testMultiScheduleZoneChange();
 	void testMultiTermResult();
 
 private:
 	QTemporaryDir tDir;
 	EventExpressionParser *parser;
+
+	static QDateTime applySubTerms(const Term &term, const QDateTime &datetime, bool applyFenced);
 };
 
 void ParserTest::initTestCase()
@@ -1971,6 +1989,11 @@ void ParserTest::testTermEvaluation_data()
 								  << QDateTime{{2018, 4, 27}, cTime}
 								  << QDateTime{{2018, 8, 10}, cTime}
 								  << EventExpressionParser::NoError;
+	QTest::addRow("valid.sequence.monthEnd") << QStringLiteral("in 1 month and 30 mins")
+										 << QTime{9, 0}
+										 << QDateTime{{2018, 1, 30}, {23, 45}}
+										 << QDateTime{{2018, 2, 28}, {0, 15}}
+										 << EventExpressionParser::NoError;
 	QTest::addRow("invalid.past") << QStringLiteral("11.09.2015 at half past 3 am")
 								  << QTime{}
 								  << QDateTime{cDate, cTime}
@@ -2005,6 +2028,132 @@ void ParserTest::testTermEvaluation()
 	}
 }
 
+void ParserTest::testTermPrograms_data()
+{
+	QTest::addColumn<QString>("expression");
+	QTest::addColumn<QDateTime>("since");
+	QTest::addColumn<bool>("fenced");
+
+	const auto cTime = QTime::currentTime();
+	QTest::addRow("time.future") << QStringLiteral("14:00")
+								 << QDateTime{{2018, 3, 10}, {10, 0}}
+								 << false;
+	QTest::addRow("time.past") << QStringLiteral("14:00")
+							   << QDateTime{{2018, 3, 10}, {17, 0}}
+							   << false;
+	QTest::addRow("date.past") << QStringLiteral("March 24th")
+							   << QDateTime{{2018, 7, 10}, cTime}
+							   << false;
+	QTest::addRow("date.absolute") << QStringLiteral("in 2019 on 24.10. at quarter past 10")
+								   << QDateTime{{2018, 7, 10}, cTime}
+								   << false;
+	QTest::addRow("day.short") << QStringLiteral("31st")
+							   << QDateTime{{2018, 2, 10}, cTime}
+							   << false;
+	QTest::addRow("day.past") << QStringLiteral("31st")
+							  << QDateTime{{2018, 1, 31}, {23, 0}}
+							  << false;
+	QTest::addRow("weekday.past") << QStringLiteral("Saturday")
+								  << QDateTime{{2018, 8, 26}, cTime}
+								  << false;
+	QTest::addRow("weekday.month") << QStringLiteral("every Wed in June")
+								   << QDateTime{{2018, 4, 2}, cTime}
+								   << false;
+	QTest::addRow("month.past") << QStringLiteral("September")
+								<< QDateTime{{2018, 10, 2}, cTime}
+								<< false;
+	QTest::addRow("year") << QStringLiteral("2020")
+						  << QDateTime{{2018, 10, 2}, cTime}
+						  << false;
+	QTest::addRow("sequence") << QStringLiteral("in 1 year and 2 months and 1 week and 2 days")
+							  << QDateTime{{2018, 1, 31}, {22, 0}}
+							  << false;
+	QTest::addRow("sequence.fenced") << QStringLiteral("in 2 weeks and 30 mins")
+									 << QDateTime{{2018, 1, 31}, {22, 0}}
+									 << true;
+	QTest::addRow("sequence.monthEnd") << QStringLiteral("in 1 month and 30 mins")
+									   << QDateTime{{2018, 1, 30}, {23, 45}}
+									   << false;
+	QTest::addRow("sequence.time") << QStringLiteral("in 10 days at 14:30")
+							 << QDateTime{{2018, 12, 31}, {10, 0}}
+							 << false;
+	QTest::addRow("loop.sequence") << QStringLiteral("every 2 years and 3 months on Saturday")
+								  << QDateTime{{2018, 8, 29}, {16, 0}}
+								  << false;
+	QTest::addRow("loop.fenced") << QStringLiteral("every September on 27th")
+								 << QDateTime{{2018, 8, 31}, cTime}
+								 << true;
+}
+
+void ParserTest::testTermPrograms()
+{
+	QFETCH(QString, expression);
+	QFETCH(QDateTime, since);
+	QFETCH(bool, fenced);
+
+	try {
+		auto terms = parser->parseExpression(expression);
+		QCOMPARE(terms.size(), 1);
+		const auto &term = terms.first();
+		TermProgram program{term};
+		QCOMPARE(program.isEmpty(), term.isEmpty());
+		QCOMPARE(program.run(since, fenced), applySubTerms(term, since, fenced));
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ParserTest::benchmarkTermApply()
+{
+	try {
+		auto terms = parser->parseExpression(QStringLiteral("in 1 year and 2 months and 1 week and 2 days at 14:30"));
+		QCOMPARE(terms.size(), 1);
+		const auto &term = terms.first();
+		const QDateTime since{{2018, 1, 31}, {22, 0}};
+		QDateTime res;
+		QBENCHMARK {
+			res = term.apply(since);
+		}
+		QCOMPARE(res, QDateTime({2019, 4, 9}, {14, 30}));
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ParserTest::testTimeZoneService_data()
+{
+	QTest::addColumn<QDate>("date");
+	QTest::addColumn<QTime>("time");
+
+	QTest::addRow("winter") << QDate{2018, 1, 10} << QTime{14, 0};
+	QTest::addRow("summer") << QDate{2018, 7, 10} << QTime{14, 0};
+	QTest::addRow("midnight") << QDate{2018, 12, 31} << QTime{0, 0};
+	QTest::addRow("gap") << QDate{2018, 3, 25} << QTime{2, 30};
+	QTest::addRow("overlap") << QDate{2018, 10, 28} << QTime{2, 30};
+	QTest::addRow("past") << QDate{1970, 6, 1} << QTime{12, 0};
+	QTest::addRow("future") << QDate{2150, 6, 1} << QTime{12, 0};
+}
+
+void ParserTest::testTimeZoneService()
+{
+	QFETCH(QDate, date);
+	QFETCH(QTime, time);
+
+	const auto service = TimeZoneService::instance();
+	const QDateTime datetime{date, time};
+	const auto msecs = datetime.toMSecsSinceEpoch();
+	QCOMPARE(service->offsetFromUtc(msecs), datetime.offsetFromUtc());
+	QCOMPARE(service->toMSecsSinceEpoch(datetime), msecs);
+
+	const auto local = service->toLocalTime(date, time);
+	QCOMPARE(local.timeSpec(), Qt::LocalTime);
+	QCOMPARE(local, datetime);
+	QCOMPARE(local.date(), datetime.date());
+	QCOMPARE(local.time(), datetime.time());
+	QCOMPARE(service->toMSecsSinceEpoch(local), msecs);
+	QCOMPARE(service->checkSystemZone(), false);
+}
+
 void ParserTest::testSingularSchedules_data()
 {
 	QTest::addColumn<QString>("expression");
@@ -2354,6 +2503,20 @@ void ParserTest::testMultiSchedules_data()
 									{{2018, 10, 3}, {9, 0}},
 								}
 						   << EventExpressionParser::NoError;
+	QTest::addRow("loops.overlapping") << QStringLiteral("every 2 days; every 3 days; every Monday")
+									   << QTime{9, 0}
+									   << QDateTime{{2018, 7, 2}, {10, 0}}
+									   << QList<QDateTime>{
+											  {{2018, 7, 4}, {9, 0}},
+											  {{2018, 7, 5}, {9, 0}},
+											  {{2018, 7, 6}, {9, 0}},
+											  {{2018, 7, 8}, {9, 0}},
+											  {{2018, 7, 9}, {9, 0}},
+											  {{2018, 7, 10}, {9, 0}},
+											  {{2018, 7, 11}, {9, 0}},
+											  {{2018, 7, 12}, {9, 0}},
+										  }
+									   << EventExpressionParser::NoError;
 }
 
 void ParserTest::testMultiSchedules()
@@ -2389,6 +2552,278 @@ void ParserTest::testMultiSchedules()
 	}
 }
 
+void ParserTest::testScheduleJumps_data()
+{
+	QTest::addColumn<QString>("expression");
+	QTest::addColumn<QDateTime>("since");
+	QTest::addColumn<QDateTime>("reference");
+
+	const QDateTime since{{2018, 1, 10}, {10, 0}};
+	QTest::addRow("span.minutes") << QStringLiteral("every 5 minutes")
+								  << since
+								  << QDateTime{{2018, 2, 14}, {13, 37}};
+	QTest::addRow("span.hours") << QStringLiteral("every 7 hours and 20 minutes")
+								<< since
+								<< QDateTime{{2018, 11, 3}, {4, 12}};
+	QTest::addRow("span.days") << QStringLiteral("every 3 days at 17:30")
+							   << since
+							   << QDateTime{{2019, 5, 20}, {17, 30}};
+	QTest::addRow("span.weeks") << QStringLiteral("every 2 weeks")
+								<< since
+								<< QDateTime{{2018, 12, 24}, {8, 0}};
+	QTest::addRow("span.mixed") << QStringLiteral("every 2 months and 3 days at 17:30")
+								<< since
+								<< QDateTime{{2020, 6, 1}, {12, 0}};
+	QTest::addRow("span.close") << QStringLiteral("every day")
+								<< since
+								<< QDateTime{{2018, 1, 11}, {9, 0}};
+	QTest::addRow("point.weekday") << QStringLiteral("every Monday")
+								   << since
+								   << QDateTime{{2019, 3, 4}, {9, 30}};
+	QTest::addRow("point.monthday") << QStringLiteral("every 31st at 18:00")
+									<< since
+									<< QDateTime{{2019, 4, 30}, {18, 0}};
+	QTest::addRow("point.weekday.exact") << QStringLiteral("every Friday at 7:00")
+										 << since
+										 << QDateTime{{2018, 6, 8}, {7, 0}};
+	QTest::addRow("fenced.singular") << QStringLiteral("every day in October")
+									 << since
+									 << QDateTime{{2021, 10, 12}, {12, 0}};
+	QTest::addRow("fenced.weekday") << QStringLiteral("every Monday in August")
+									<< since
+									<< QDateTime{{2022, 1, 1}, {0, 0}};
+	QTest::addRow("fenced.elaborate") << QStringLiteral("every 2 Weeks on Saturday at quarter past 3 pm in November")
+									  << since
+									  << QDateTime{{2023, 11, 18}, {15, 15}};
+	QTest::addRow("limits.until") << QStringLiteral("every 3 Months on 27th until 2019")
+								  << since
+								  << QDateTime{{2020, 1, 1}, {0, 0}};
+	QTest::addRow("limits.interval") << QStringLiteral("every 20 minutes until 2019")
+									 << since
+									 << QDateTime{{2019, 6, 1}, {0, 0}};
+	QTest::addRow("multi") << QStringLiteral("every 25th; every 30 days")
+						   << since
+						   << QDateTime{{2019, 7, 25}, {9, 0}};
+	QTest::addRow("past") << QStringLiteral("every 20 minutes")
+						  << since
+						  << QDateTime{{2017, 1, 1}, {0, 0}};
+}
+
+void ParserTest::testScheduleJumps()
+{
+	QFETCH(QString, expression);
+	QFETCH(QDateTime, since);
+	QFETCH(QDateTime, reference);
+
+	try {
+		parser->_settings->scheduler.defaultTime = QTime{9, 0};
+		auto terms = parser->parseMultiExpression(expression);
+		auto stepped = parser->createMultiSchedule(terms, {}, since);
+		auto jumped = parser->createMultiSchedule(terms, {}, since);
+		QVERIFY(stepped);
+		QVERIFY(jumped);
+
+		QDateTime result;
+		do {
+			result = stepped->nextSchedule();
+		} while(result.isValid() && result <= reference);
+
+		QSignalSpy changedSpy{jumped.data(), &Schedule::currentChanged};
+		QCOMPARE(jumped->nextScheduleAfter(reference), result);
+		QCOMPARE(jumped->current(), result);
+		QCOMPARE(changedSpy.size(), 1);
+
+		// both must continue the same way
+		for(auto i = 0; i < 5 && result.isValid(); ++i) {
+			result = stepped->nextSchedule();
+			QCOMPARE(jumped->nextSchedule(), result);
+		}
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ParserTest::testScheduleOccurrences_data()
+{
+	QTest::addColumn<QString>("expression");
+	QTest::addColumn<QDateTime>("since");
+	QTest::addColumn<QDateTime>("from");
+	QTest::addColumn<QDateTime>("to");
+	QTest::addColumn<int>("limit");
+	QTest::addColumn<QList<QDateTime>>("results");
+
+	const QDateTime since{{2018, 1, 10}, {10, 0}};
+	QTest::addRow("singular") << QStringLiteral("on 14th at 10:00")
+							  << since
+							  << since
+							  << QDateTime{{2018, 2, 1}, {0, 0}}
+							  << -1
+							  << QList<QDateTime> {
+									 {{2018, 1, 14}, {10, 0}}
+								 };
+	QTest::addRow("singular.outside") << QStringLiteral("on 14th at 10:00")
+									  << since
+									  << QDateTime{{2018, 1, 14}, {10, 1}}
+									  << QDateTime{{2018, 2, 1}, {0, 0}}
+									  << -1
+									  << QList<QDateTime>{};
+	QTest::addRow("span") << QStringLiteral("every 20 minutes")
+						  << since
+						  << QDateTime{{2018, 3, 1}, {10, 0}}
+						  << QDateTime{{2018, 3, 1}, {11, 0}}
+						  << -1
+						  << QList<QDateTime> {
+								 {{2018, 3, 1}, {10, 0}},
+								 {{2018, 3, 1}, {10, 20}},
+								 {{2018, 3, 1}, {10, 40}}
+							 };
+	QTest::addRow("limited") << QStringLiteral("every day at 8:00")
+							 << since
+							 << since
+							 << QDateTime{{2019, 1, 1}, {0, 0}}
+							 << 2
+							 << QList<QDateTime> {
+									{{2018, 1, 11}, {8, 0}},
+									{{2018, 1, 12}, {8, 0}}
+								};
+	QTest::addRow("fenced") << QStringLiteral("every Monday in August")
+							<< since
+							<< QDateTime{{2019, 1, 1}, {0, 0}}
+							<< QDateTime{{2020, 1, 1}, {0, 0}}
+							<< -1
+							<< QList<QDateTime> {
+								   {{2019, 8, 5}, {9, 0}},
+								   {{2019, 8, 12}, {9, 0}},
+								   {{2019, 8, 19}, {9, 0}},
+								   {{2019, 8, 26}, {9, 0}}
+							   };
+	QTest::addRow("multi") << QStringLiteral("every 25th; every 10 days")
+						   << since
+						   << QDateTime{{2018, 1, 15}, {0, 0}}
+						   << QDateTime{{2018, 2, 15}, {0, 0}}
+						   << -1
+						   << QList<QDateTime> {
+								  {{2018, 1, 20}, {9, 0}},
+								  {{2018, 1, 25}, {9, 0}},
+								  {{2018, 1, 30}, {9, 0}},
+								  {{2018, 2, 9}, {9, 0}}
+							  };
+}
+
+void ParserTest::testScheduleOccurrences()
+{
+	QFETCH(QString, expression);
+	QFETCH(QDateTime, since);
+	QFETCH(QDateTime, from);
+	QFETCH(QDateTime, to);
+	QFETCH(int, limit);
+	QFETCH(QList<QDateTime>, results);
+
+	try {
+		parser->_settings->scheduler.defaultTime = QTime{9, 0};
+		auto terms = parser->parseMultiExpression(expression);
+		auto schedule = parser->createMultiSchedule(terms, {}, since);
+		QVERIFY(schedule);
+		const auto current = schedule->current();
+
+		QSignalSpy changedSpy{schedule.data(), &Schedule::currentChanged};
+		auto occurrences = QtConcurrent::run([&](){
+			return schedule->occurrences(from, to, limit);
+		}).result();
+		QCOMPARE(occurrences.toList(), results);
+		QCOMPARE(schedule->current(), current);
+		QCOMPARE(changedSpy.size(), 0);
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ParserTest::testScheduleCursors_data()
+{
+	QTest::addColumn<QString>("expression");
+
+	QTest::addRow("singular") << QStringLiteral("on 14th at 10:00");
+	QTest::addRow("repeated") << QStringLiteral("every 7 hours and 20 minutes on Monday");
+	QTest::addRow("fenced") << QStringLiteral("every 2 Weeks on Saturday at quarter past 3 pm in November");
+	QTest::addRow("multi") << QStringLiteral("every 25th; every 10 days; every Monday");
+}
+
+void ParserTest::testScheduleCursors()
+{
+	QFETCH(QString, expression);
+
+	try {
+		parser->_settings->scheduler.defaultTime = QTime{9, 0};
+		auto terms = parser->parseMultiExpression(expression);
+		QSharedPointer<const Schedule> schedule = parser->createMultiSchedule(terms, {}, QDateTime{{2018, 1, 10}, {10, 0}});
+		QVERIFY(schedule);
+		const auto cursor = schedule->cursor();
+
+		// evaluate the same definition from multiple threads at once
+		QVector<QDateTime> references;
+		for(auto i = 1; i <= 8; ++i)
+			references.append(QDateTime{{2018 + i, i, 10 + i}, {i, 0}});
+		const auto results = QtConcurrent::blockingMapped(references, std::function<ScheduleCursor(QDateTime)>{[&](QDateTime reference){
+			auto tCursor = cursor;
+			schedule->nextAfter(tCursor, reference);
+			schedule->next(tCursor);
+			return tCursor;
+		}});
+		QCOMPARE(schedule->cursor(), cursor);
+
+		for(auto i = 0; i < references.size(); ++i) {
+			auto copy = schedule->clone();
+			copy->nextScheduleAfter(references[i]);
+			copy->nextSchedule();
+			QCOMPARE(copy->current(), results[i].current);
+			QCOMPARE(copy->cursor(), results[i]);
+		}
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ParserTest::testMultiScheduleZoneChange()
+{
+	// restores the system zone, even if a check fails
+	struct ZoneGuard {
+		const bool wasSet = qEnvironmentVariableIsSet("TZ");
+		const QByteArray tz = qgetenv("TZ");
+		~ZoneGuard() {
+			if(wasSet)
+				qputenv("TZ", tz);
+			else
+				qunsetenv("TZ");
+			tzset();
+			TimeZoneService::instance()->checkSystemZone();
+		}
+	} guard;
+	const auto setZone = [](const QByteArray &tz) {
+		qputenv("TZ", tz);
+		tzset();
+		TimeZoneService::instance()->checkSystemZone();
+	};
+
+	try {
+		setZone("Europe/Berlin");
+		parser->_settings->scheduler.defaultTime = QTime{9, 0};
+		auto terms = parser->parseMultiExpression(QStringLiteral("every day at 10:00; every day at 12:00"));
+		auto schedule = parser->createMultiSchedule(terms, {}, QDateTime{{2018, 1, 10}, {9, 0}});
+		QVERIFY(schedule);
+		QCOMPARE(schedule->current(), QDateTime({2018, 1, 10}, {10, 0}));
+		auto cursor = schedule->cursor();
+
+		// the heap of the sub schedules was ordered in the old zone, nothing may be skipped
+		setZone("America/New_York");
+		QCOMPARE(schedule->nextSchedule(), QDateTime({2018, 1, 10}, {12, 0}));
+		QCOMPARE(schedule->nextSchedule(), QDateTime({2018, 1, 11}, {10, 0}));
+		QCOMPARE(schedule->next(cursor), QDateTime({2018, 1, 10}, {12, 0}));
+		QCOMPARE(schedule->next(cursor), QDateTime({2018, 1, 11}, {10, 0}));
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
 void ParserTest::testMultiTermResult()
 {
 	auto cDate = QDate::currentDate();
@@ -2466,6 +2901,29 @@ void ParserTest::testMultiTermResult()
 	}
 }
 
+QDateTime ParserTest::applySubTerms(const Term &term, const QDateTime &datetime, bool applyFenced)
+{
+	// reference implementation: walk the subterms directly
+	auto appointment = datetime;
+	for(const auto &subTerm : term) {
+		if(subTerm->type.testFlag(SubTerm::FlagLimiter))
+			continue;
+		subTerm->apply(appointment, applyFenced);
+		if(subTerm->type.testFlag(SubTerm::Timepoint))
+			applyFenced = true;
+	}
+
+	if(appointment <= datetime && !term.isEmpty()) {
+		term.first()->fixup(appointment);
+		for(const auto &subTerm : term) {
+			if(subTerm->type.testFlag(SubTerm::FlagNeedsFixupCleanup))
+				subTerm->fixupCleanup(appointment);
+		}
+	}
+
+	return appointment;
+}
+
 QTEST_MAIN(ParserTest)
 
 #include "tst_parser.moc"
@@ -0,0 +1,14 @@
+TEMPLATE = app
+
+QT += testlib mvvmcore datasync
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = tst_reminderjson
+
+SOURCES += \
+		tst_reminderjson.cpp
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+
+include(../../lib.pri)
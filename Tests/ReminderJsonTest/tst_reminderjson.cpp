@@ -0,0 +1,360 @@
+#include <QtTest>
+#include <QtMvvmCore>
+#include <QtDataSync>
+#include <QJsonSerializer>
+
+#include <eventexpressionparser.h>
+#include <libsyrem.h>
+#include <schedule.h>
+#include <terms.h>
+#include <timezoneservice.h>
+#include <ctime>
+
+class ReminderJsonTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testRoundTrip_data();
+	void testRoundTrip();
+	void testLazySchedule_data();
+	void testLazySchedule();
+	void testBrokenSchedule();
+	void testZoneChange();
+	void testTermJson_data();
+	void testTermJson();
+
+	void benchmarkSerialize();
+	void benchmarkDeserialize();
+
+private:
+	QTemporaryDir tDir;
+	EventExpressionParser *parser;
+	QtDataSync::DataStore *store;
+
+	Reminder createReminder(const QString &query, bool important = false, const QDateTime &snooze = {});
+	static QJsonDocument toJson(const Reminder &reminder);
+	static Reminder fromJson(const QJsonObject &object);
+	static QJsonArray referenceJson(const Expressions::Term &term);
+	void compareTerms(const Schedule *schedule, const QJsonObject &object);
+	void addQueryRows();
+};
+
+void ReminderJsonTest::initTestCase()
+{
+	QLocale::setDefault(QLocale::c());
+
+	QtDataSync::Setup()
+			.setLocalDir(tDir.path())
+			.create();
+
+	SyncedSettings::instance()->scheduler.defaultTime = QTime{};
+	parser = QtMvvm::ServiceRegistry::instance()->constructInjected<EventExpressionParser>(this);
+	store = new QtDataSync::DataStore{this};
+}
+
+void ReminderJsonTest::cleanupTestCase()
+{
+	delete store;
+	delete parser;
+}
+
+void ReminderJsonTest::addQueryRows()
+{
+	QTest::addColumn<QString>("query");
+	QTest::addColumn<bool>("important");
+	QTest::addColumn<QDateTime>("snooze");
+
+	QTest::addRow("singular") << QStringLiteral("on 11.11.2017 at 11:11")
+							  << false
+							  << QDateTime();
+	QTest::addRow("singular.important") << QStringLiteral("in 1 hours and 20 minutes")
+										<< true
+										<< QDateTime();
+	QTest::addRow("repeated") << QStringLiteral("every 2 days at 19:45")
+							  << false
+							  << QDateTime();
+	QTest::addRow("repeated.until") << QStringLiteral("every Thursday at 18:00 until 1. December")
+									<< false
+									<< QDateTime();
+	QTest::addRow("repeated.snoozed") << QStringLiteral("every 12 hours and 30 minutes from 27. at 15:00")
+									  << true
+									  << QDateTime({2030, 1, 1}, {12, 00});
+	QTest::addRow("multi") << QStringLiteral("on 11.11.2017 at 11:11;"
+											 "in 2 Months on 7.;"
+											 "every 2 years on 13. August at 15:30 until 2022")
+						   << false
+						   << QDateTime();
+}
+
+void ReminderJsonTest::testRoundTrip_data()
+{
+	addQueryRows();
+}
+
+void ReminderJsonTest::testRoundTrip()
+{
+	QFETCH(QString, query);
+	QFETCH(bool, important);
+	QFETCH(QDateTime, snooze);
+
+	try {
+		auto reminder = createReminder(query, important, snooze);
+		auto decoded = fromJson(toJson(reminder).object());
+		QCOMPARE(toJson(decoded), toJson(reminder));
+		QCOMPARE(decoded.current(), reminder.current());
+		QCOMPARE(decoded.triggerState(), reminder.triggerState());
+		// local times are stored as wall times
+		QCOMPARE(decoded.due().timeSpec(), Qt::LocalTime);
+		const auto jsonDue = QDateTime::fromString(toJson(reminder).object().value(QStringLiteral("due")).toString(), Qt::ISODate);
+		QCOMPARE(jsonDue.timeSpec(), Qt::LocalTime);
+		QCOMPARE(jsonDue, reminder.due());
+
+		// the cursor state must be restored as well, not only the definition
+		const auto from = QDateTime({2017, 10, 24});
+		const auto to = from.addYears(10);
+		QCOMPARE(decoded.occurrences(from, to, 20), reminder.occurrences(from, to, 20));
+
+		// an advanced reminder shares the definition, but not the state
+		auto advanced = reminder;
+		if(advanced.advanceSchedule(advanced.due())) {
+			const auto occurrences = advanced.occurrences(from, to, 20);
+			QVERIFY(!occurrences.isEmpty());
+			QCOMPARE(occurrences.first(), advanced.due());
+			QCOMPARE(fromJson(toJson(advanced).object()).occurrences(from, to, 20), occurrences);
+			QCOMPARE(reminder.occurrences(from, to, 20).first(), reminder.due());
+		}
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ReminderJsonTest::testLazySchedule_data()
+{
+	addQueryRows();
+}
+
+void ReminderJsonTest::testLazySchedule()
+{
+	QFETCH(QString, query);
+	QFETCH(bool, important);
+	QFETCH(QDateTime, snooze);
+
+	try {
+		auto reminder = createReminder(query, important, snooze);
+		auto object = toJson(reminder).object();
+		QVERIFY(object.contains(QStringLiteral("due")));
+		QVERIFY(object.contains(QStringLiteral("repeating")));
+
+		for(auto legacy : {false, true}) {
+			if(legacy) { // data from before the fields existed
+				object.remove(QStringLiteral("due"));
+				object.remove(QStringLiteral("repeating"));
+			}
+			auto decoded = fromJson(object);
+			QCOMPARE(decoded.due(), reminder.due());
+			QCOMPARE(decoded.current(), reminder.current());
+			QCOMPARE(decoded.isRepeating(), reminder.isRepeating());
+			// unchanged data is written back as it was loaded
+			QCOMPARE(toJson(decoded).object().value(QStringLiteral("schedule")), object.value(QStringLiteral("schedule")));
+
+			const auto from = QDateTime({2017, 10, 24});
+			const auto to = from.addYears(10);
+			QCOMPARE(decoded.scheduleCursor(), reminder.scheduleCursor());
+			QCOMPARE(decoded.occurrences(from, to, 20), reminder.occurrences(from, to, 20));
+		}
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ReminderJsonTest::testBrokenSchedule()
+{
+	try {
+		const auto reminder = createReminder(QStringLiteral("every 2 days at 19:45"));
+		auto object = toJson(reminder).object();
+		const QJsonObject broken {
+			{QStringLiteral("@class"), QStringLiteral("NoSuchSchedule")}
+		};
+		object.insert(QStringLiteral("schedule"), broken);
+
+		auto decoded = fromJson(object);
+		QCOMPARE(decoded.current(), reminder.current());
+		QVERIFY_EXCEPTION_THROWN(decoded.schedule(), QException);
+		QVERIFY_EXCEPTION_THROWN(decoded.scheduleCursor(), QException);
+		// the failure is remembered instead of leaving a reminder without a schedule
+		QVERIFY_EXCEPTION_THROWN(decoded.advanceSchedule(reminder.current()), QException);
+		QCOMPARE(decoded.due(), reminder.due());
+		QCOMPARE(decoded.versionCode(), reminder.versionCode());
+		// the broken data is written back as it was loaded
+		QCOMPARE(toJson(decoded).object().value(QStringLiteral("schedule")).toObject(), broken);
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ReminderJsonTest::testZoneChange()
+{
+	// restores the system zone, even if a check fails
+	struct ZoneGuard {
+		const bool wasSet = qEnvironmentVariableIsSet("TZ");
+		const QByteArray tz = qgetenv("TZ");
+		~ZoneGuard() {
+			if(wasSet)
+				qputenv("TZ", tz);
+			else
+				qunsetenv("TZ");
+			tzset();
+			TimeZoneService::instance()->checkSystemZone();
+		}
+	} guard;
+	const auto service = TimeZoneService::instance();
+	const auto setZone = [service](const QByteArray &tz) {
+		qputenv("TZ", tz);
+		tzset();
+		service->checkSystemZone();
+	};
+
+	try {
+		setZone("Europe/Berlin");
+		const auto reminder = createReminder(QStringLiteral("every day at 15:00"));
+		const auto due = reminder.due();
+		QCOMPARE(due.timeSpec(), Qt::LocalTime);
+		const auto object = toJson(reminder).object();
+
+		// the wall time stays the same, the utc time follows the new zone
+		setZone("America/New_York");
+		QCOMPARE(service->systemZone().id(), QByteArrayLiteral("America/New_York"));
+		auto decoded = fromJson(object);
+		QCOMPARE(decoded.due().timeSpec(), Qt::LocalTime);
+		QCOMPARE(decoded.due().date(), due.date());
+		QCOMPARE(decoded.due().time(), due.time());
+		QCOMPARE(decoded.due().toMSecsSinceEpoch(), QDateTime(due.date(), due.time(), service->systemZone()).toMSecsSinceEpoch());
+		QVERIFY(decoded.advanceSchedule(decoded.due()));
+		QCOMPARE(decoded.due().timeSpec(), Qt::LocalTime);
+		QCOMPARE(decoded.due().date(), due.date().addDays(1));
+		QCOMPARE(decoded.due().time(), due.time());
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ReminderJsonTest::testTermJson_data()
+{
+	addQueryRows();
+	QTest::addRow("sequence") << QStringLiteral("every 7 hours and 20 minutes on Monday")
+							  << false
+							  << QDateTime();
+	QTest::addRow("fenced") << QStringLiteral("every 2 Weeks on Saturday at quarter past 3 pm in November")
+							<< false
+							<< QDateTime();
+}
+
+void ReminderJsonTest::testTermJson()
+{
+	QFETCH(QString, query);
+
+	try {
+		auto reminder = createReminder(query);
+		const auto schedule = toJson(reminder).object().value(QStringLiteral("schedule")).toObject();
+		compareTerms(reminder.schedule().data(), schedule);
+
+		auto decoded = fromJson(toJson(reminder).object());
+		QVERIFY(decoded.schedule());
+		QCOMPARE(toJson(decoded).object().value(QStringLiteral("schedule")).toObject(), schedule);
+	} catch(QException &e) {
+		QFAIL(e.what());
+	}
+}
+
+void ReminderJsonTest::benchmarkSerialize()
+{
+	const auto reminder = createReminder(QStringLiteral("on 11.11.2017 at 11:11;"
+														"every Thursday at 18:00 until 1. December;"
+														"every 2 years on 13. August at 15:30 until 2022"));
+	QBENCHMARK {
+		toJson(reminder);
+	}
+}
+
+void ReminderJsonTest::benchmarkDeserialize()
+{
+	const auto object = toJson(createReminder(QStringLiteral("on 11.11.2017 at 11:11;"
+															 "every Thursday at 18:00 until 1. December;"
+															 "every 2 years on 13. August at 15:30 until 2022"))).object();
+	// the schedule is only deserialized when needed
+	QBENCHMARK {
+		fromJson(object).schedule();
+	}
+}
+
+Reminder ReminderJsonTest::createReminder(const QString &query, bool important, const QDateTime &snooze)
+{
+	Reminder reminder;
+	reminder.setId(QUuid::createUuid());
+	reminder.setDescription(QStringLiteral("Reminder for \"%1\" with https://example.org").arg(query));
+	reminder.setImportant(important);
+	reminder.setExpression(query);
+	reminder.setSchedule(parser->createMultiSchedule(parser->parseMultiExpression(query), {}, QDateTime({2017, 10, 24}, {15, 00})));
+	if(snooze.isValid())
+		reminder.performSnooze(store, snooze);
+	return reminder;
+}
+
+QJsonDocument ReminderJsonTest::toJson(const Reminder &reminder)
+{
+	return QJsonDocument{Syrem::serializer()->serialize(reminder)};
+}
+
+Reminder ReminderJsonTest::fromJson(const QJsonObject &object)
+{
+	return Syrem::serializer()->deserialize<Reminder>(object);
+}
+
+QJsonArray ReminderJsonTest::referenceJson(const Expressions::Term &term)
+{
+	// what the property based serialization writes for each subterm
+	QJsonArray array;
+	for(const auto &subTerm : term) {
+		const auto metaObject = subTerm->metaObject();
+		QJsonObject object;
+		object.insert(QStringLiteral("@class"), QString::fromUtf8(metaObject->className()));
+		object.insert(QStringLiteral("type"), static_cast<int>(subTerm->type));
+		object.insert(QStringLiteral("scope"), static_cast<int>(subTerm->scope));
+		for(auto i = Expressions::SubTerm::staticMetaObject.propertyCount(); i < metaObject->propertyCount(); i++) {
+			const auto property = metaObject->property(i);
+			const auto value = property.read(subTerm.data());
+			if(value.userType() == qMetaTypeId<QMap<QString, int>>()) {
+				const auto map = value.value<QMap<QString, int>>();
+				QJsonObject mapObject;
+				for(auto it = map.constBegin(); it != map.constEnd(); ++it)
+					mapObject.insert(it.key(), it.value());
+				object.insert(QString::fromUtf8(property.name()), mapObject);
+			} else
+				object.insert(QString::fromUtf8(property.name()), QJsonValue::fromVariant(value));
+		}
+		array.append(object);
+	}
+	return array;
+}
+
+void ReminderJsonTest::compareTerms(const Schedule *schedule, const QJsonObject &object)
+{
+	if(auto repeated = qobject_cast<const RepeatedSchedule*>(schedule)) {
+		QCOMPARE(object.value(QStringLiteral("loopTerm")).toArray(), referenceJson(repeated->getLoopTerm()));
+		QCOMPARE(object.value(QStringLiteral("fenceTerm")).toArray(), referenceJson(repeated->getFenceTerm()));
+	} else if(auto multi = qobject_cast<const MultiSchedule*>(schedule)) {
+		const auto subSchedules = multi->getSubSchedules();
+		const auto array = object.value(QStringLiteral("subSchedules")).toArray();
+		QCOMPARE(array.size(), subSchedules.size());
+		for(auto i = 0; i < array.size(); i++)
+			compareTerms(subSchedules[i].data(), array[i].toObject());
+	}
+}
+
+QTEST_MAIN(ReminderJsonTest)
+
+#include "tst_reminderjson.moc"
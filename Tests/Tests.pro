@@ -2,4 +2,6 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
 	CoreReminder \
-    ParserTest
+	ParserTest \
+	TimerQueueTest \
+	ReminderJsonTest
@@ -0,0 +1,21 @@
+TEMPLATE = app
+
+QT += testlib
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = tst_timerqueue
+
+DAEMON_DIR = $$PWD/../../daemons/desktop
+
+HEADERS += \
+		$$DAEMON_DIR/timerqueue.h
+
+SOURCES += \
+		tst_timerqueue.cpp \
+		$$DAEMON_DIR/timerqueue.cpp
+
+INCLUDEPATH += $$DAEMON_DIR
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
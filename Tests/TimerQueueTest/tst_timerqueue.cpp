@@ -0,0 +1,360 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <timerqueue.h>
+
+class TimerQueueTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+	void initTestCase_data();
+
+	void testOrder_data();
+	void testOrder();
+	void testReplace_data();
+	void testReplace();
+	void testRemove_data();
+	void testRemove();
+	void testTakeDue_data();
+	void testTakeDue();
+	void testLongRange_data();
+	void testLongRange();
+	void testWakeUps_data();
+	void testWakeUps();
+	void benchmarkChurn_data();
+	void benchmarkChurn();
+
+private:
+	static QSharedPointer<TimerQueue> createQueue();
+	static TimerQueue *newQueue();
+	static QUuid uuid(int index);
+	static QList<int> indexes(const QList<QUuid> &ids);
+};
+
+void TimerQueueTest::initTestCase_data()
+{
+	QTest::addColumn<bool>("wheel");
+
+	QTest::addRow("heap") << false;
+	QTest::addRow("wheel") << true;
+}
+
+void TimerQueueTest::testOrder_data()
+{
+	QTest::addColumn<QList<qint64>>("dues");
+	QTest::addColumn<QList<int>>("order");
+
+	QTest::addRow("empty") << QList<qint64>{}
+						   << QList<int>{};
+	QTest::addRow("single") << QList<qint64>{42}
+							<< QList<int>{0};
+	QTest::addRow("sorted") << QList<qint64>{1, 2, 3, 4, 5}
+							<< QList<int>{0, 1, 2, 3, 4};
+	QTest::addRow("reversed") << QList<qint64>{5, 4, 3, 2, 1}
+							  << QList<int>{4, 3, 2, 1, 0};
+	QTest::addRow("mixed") << QList<qint64>{30, 10, 50, 20, 40, 60, 0}
+						   << QList<int>{6, 1, 3, 0, 4, 2, 5};
+	QTest::addRow("negative") << QList<qint64>{10, -10, 0}
+							  << QList<int>{1, 2, 0};
+}
+
+void TimerQueueTest::testOrder()
+{
+	QFETCH(QList<qint64>, dues);
+	QFETCH(QList<int>, order);
+
+	auto queue = createQueue();
+	for(auto i = 0; i < dues.size(); ++i)
+		queue->insert(uuid(i), dues[i]);
+	QCOMPARE(queue->size(), dues.size());
+	QCOMPARE(queue->nextDue(), order.isEmpty() ? TimerQueue::NoDue : dues[order.first()]);
+	QCOMPARE(indexes(queue->takeDue(TimerQueue::NoDue)), order);
+	QVERIFY(queue->isEmpty());
+}
+
+void TimerQueueTest::testReplace_data()
+{
+	QTest::addColumn<qint64>("due");
+	QTest::addColumn<QList<int>>("order");
+
+	QTest::addRow("earliest") << 5ll
+							  << QList<int>{1, 0, 2};
+	QTest::addRow("middle") << 25ll
+							<< QList<int>{0, 1, 2};
+	QTest::addRow("latest") << 50ll
+							<< QList<int>{0, 2, 1};
+	QTest::addRow("same") << 20ll
+						  << QList<int>{0, 1, 2};
+}
+
+void TimerQueueTest::testReplace()
+{
+	QFETCH(qint64, due);
+	QFETCH(QList<int>, order);
+
+	auto queue = createQueue();
+	queue->insert(uuid(0), 10);
+	queue->insert(uuid(1), 20);
+	queue->insert(uuid(2), 30);
+	queue->insert(uuid(1), due);
+	QCOMPARE(queue->size(), 3);
+	QCOMPARE(indexes(queue->takeDue(TimerQueue::NoDue)), order);
+}
+
+void TimerQueueTest::testRemove_data()
+{
+	QTest::addColumn<int>("index");
+	QTest::addColumn<bool>("removed");
+	QTest::addColumn<QList<int>>("order");
+
+	QTest::addRow("first") << 3 << true
+						   << QList<int>{0, 2, 4, 1};
+	QTest::addRow("last") << 1 << true
+						  << QList<int>{3, 0, 2, 4};
+	QTest::addRow("middle") << 2 << true
+							<< QList<int>{3, 0, 4, 1};
+	QTest::addRow("missing") << 7 << false
+							 << QList<int>{3, 0, 2, 4, 1};
+}
+
+void TimerQueueTest::testRemove()
+{
+	QFETCH(int, index);
+	QFETCH(bool, removed);
+	QFETCH(QList<int>, order);
+
+	auto queue = createQueue();
+	const QList<qint64> dues {20, 50, 30, 10, 40};
+	for(auto i = 0; i < dues.size(); ++i)
+		queue->insert(uuid(i), dues[i]);
+
+	QCOMPARE(queue->remove(uuid(index)), removed);
+	QCOMPARE(queue->contains(uuid(index)), false);
+	QCOMPARE(queue->size(), order.size());
+	QCOMPARE(indexes(queue->takeDue(TimerQueue::NoDue)), order);
+}
+
+void TimerQueueTest::testTakeDue_data()
+{
+	QTest::addColumn<qint64>("now");
+	QTest::addColumn<QList<int>>("due");
+	QTest::addColumn<qint64>("nextDue");
+
+	QTest::addRow("none") << 5ll
+						  << QList<int>{}
+						  << 10ll;
+	QTest::addRow("exact") << 10ll
+						   << QList<int>{2}
+						   << 20ll;
+	QTest::addRow("some") << 25ll
+						  << QList<int>{2, 0}
+						  << 30ll;
+	QTest::addRow("all") << 100ll
+						 << QList<int>{2, 0, 1}
+						 << TimerQueue::NoDue;
+}
+
+void TimerQueueTest::testTakeDue()
+{
+	QFETCH(qint64, now);
+	QFETCH(QList<int>, due);
+	QFETCH(qint64, nextDue);
+
+	auto queue = createQueue();
+	queue->insert(uuid(0), 20);
+	queue->insert(uuid(1), 30);
+	queue->insert(uuid(2), 10);
+
+	QCOMPARE(indexes(queue->takeDue(now)), due);
+	QCOMPARE(queue->size(), 3 - due.size());
+	QCOMPARE(queue->nextDue(), nextDue);
+}
+
+void TimerQueueTest::testLongRange_data()
+{
+	QTest::addColumn<QList<qint64>>("offsets");
+	QTest::addColumn<QList<int>>("order");
+
+	const qint64 minute = 60 * 1000;
+	const auto hour = 60 * minute;
+	const auto day = 24 * hour;
+	QTest::addRow("minutes") << QList<qint64>{5 * minute, 30 * 1000, 59 * minute}
+							 << QList<int>{1, 0, 2};
+	QTest::addRow("hours") << QList<qint64>{3 * hour, 2 * hour + 5 * minute, 23 * hour}
+						   << QList<int>{1, 0, 2};
+	QTest::addRow("days") << QList<qint64>{40 * day, 2 * day, 2 * day + minute}
+						  << QList<int>{1, 2, 0};
+	QTest::addRow("overflow") << QList<qint64>{400 * day, 100 * day, 1000 * day + 1}
+							  << QList<int>{1, 0, 2};
+	QTest::addRow("mixed") << QList<qint64>{100 * day, 5 * minute, -hour, 3 * hour, 2 * day}
+						   << QList<int>{2, 1, 3, 4, 0};
+}
+
+void TimerQueueTest::testLongRange()
+{
+	QFETCH(QList<qint64>, offsets);
+	QFETCH(QList<int>, order);
+
+	// step from due time to due time, like the scheduler does
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	auto queue = createQueue();
+	for(auto i = 0; i < offsets.size(); ++i)
+		queue->insert(uuid(i), now + offsets[i]);
+
+	for(const auto index : order) {
+		const auto due = now + offsets[index];
+		QCOMPARE(queue->nextDue(), due);
+		QCOMPARE(queue->takeDue(due - 1), QList<QUuid>{});
+		QCOMPARE(indexes(queue->takeDue(due)), QList<int>{index});
+	}
+	QVERIFY(queue->isEmpty());
+	QCOMPARE(queue->nextDue(), TimerQueue::NoDue);
+}
+
+void TimerQueueTest::testWakeUps_data()
+{
+	QTest::addColumn<QList<qint64>>("offsets"); // in minutes
+	QTest::addColumn<QList<int>>("exact");
+	QTest::addColumn<qint64>("slack");
+	QTest::addColumn<QList<qint64>>("wakeUps");
+	QTest::addColumn<quint64>("saved");
+
+	QTest::addRow("single") << QList<qint64>{0}
+							<< QList<int>{}
+							<< 5ll
+							<< QList<qint64>{5}
+							<< 0ull;
+	QTest::addRow("window") << QList<qint64>{4, 0, 1}
+							<< QList<int>{}
+							<< 5ll
+							<< QList<qint64>{5}
+							<< 2ull;
+	QTest::addRow("apart") << QList<qint64>{0, 10}
+						   << QList<int>{}
+						   << 5ll
+						   << QList<qint64>{5, 15}
+						   << 0ull;
+	QTest::addRow("chain") << QList<qint64>{0, 4, 8}
+						   << QList<int>{}
+						   << 5ll
+						   << QList<qint64>{5, 13}
+						   << 1ull;
+	QTest::addRow("same") << QList<qint64>{2, 2, 2}
+						  << QList<int>{}
+						  << 5ll
+						  << QList<qint64>{7}
+						  << 0ull;
+	QTest::addRow("exact") << QList<qint64>{0, 1, 2, 20}
+						   << QList<int>{2, 3}
+						   << 5ll
+						   << QList<qint64>{2, 20}
+						   << 2ull;
+	QTest::addRow("exact.same") << QList<qint64>{3, 3}
+								<< QList<int>{0}
+								<< 5ll
+								<< QList<qint64>{3}
+								<< 0ull;
+	QTest::addRow("noSlack") << QList<qint64>{0, 1}
+							 << QList<int>{}
+							 << 0ll
+							 << QList<qint64>{0, 1}
+							 << 0ull;
+}
+
+void TimerQueueTest::testWakeUps()
+{
+	QFETCH(QList<qint64>, offsets);
+	QFETCH(QList<int>, exact);
+	QFETCH(qint64, slack);
+	QFETCH(QList<qint64>, wakeUps);
+	QFETCH(quint64, saved);
+
+	const qint64 minute = 60 * 1000;
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	CoalescingTimerQueue queue{newQueue(), newQueue()};
+	for(auto i = 0; i < offsets.size(); ++i)
+		queue.insert(uuid(i), now + offsets[i] * minute, exact.contains(i));
+
+	// a fake timer, that fires exactly at the time it was last armed for
+	QList<qint64> fired;
+	auto triggered = 0;
+	for(auto wakeUp = queue.nextWakeUp(slack * minute);
+		wakeUp != TimerQueue::NoDue;
+		wakeUp = queue.nextWakeUp(slack * minute)) {
+		const auto ids = queue.takeDue(wakeUp, slack * minute);
+		QVERIFY(!ids.isEmpty());
+		triggered += ids.size();
+		fired.append((wakeUp - now) / minute);
+	}
+	QCOMPARE(fired, wakeUps);
+	QCOMPARE(triggered, offsets.size());
+	QCOMPARE(queue.savedWakeUps(), saved);
+	QVERIFY(queue.isEmpty());
+}
+
+void TimerQueueTest::benchmarkChurn_data()
+{
+	QTest::addColumn<int>("days");
+
+	QTest::addRow("month") << 30;
+	// most of them beyond the 64 days of the wheel
+	QTest::addRow("year") << 365;
+}
+
+void TimerQueueTest::benchmarkChurn()
+{
+	QFETCH(int, days);
+
+	// the same mix of schedules, reschedules and cancels a sync produces, spread over the days
+	const auto count = 100000;
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	QRandomGenerator rng{42};
+	QVector<qint64> dues;
+	dues.reserve(count);
+	for(auto i = 0; i < count; ++i)
+		dues.append(now + rng.bounded(days * 24 * 60) * 60000ll + rng.bounded(60000));
+
+	QBENCHMARK {
+		auto queue = createQueue();
+		for(auto i = 0; i < count; ++i)
+			queue->insert(uuid(i), dues[i]);
+		for(auto i = 0; i < count; i += 2)
+			queue->insert(uuid(i), dues[count - i - 1]);
+		for(auto i = 0; i < count; i += 3)
+			queue->remove(uuid(i));
+		while(!queue->isEmpty())
+			queue->takeDue(queue->nextDue());
+	}
+}
+
+QSharedPointer<TimerQueue> TimerQueueTest::createQueue()
+{
+	return QSharedPointer<TimerQueue>{newQueue()};
+}
+
+TimerQueue *TimerQueueTest::newQueue()
+{
+	QFETCH_GLOBAL(bool, wheel);
+	if(wheel)
+		return new WheelTimerQueue{};
+	else
+		return new HeapTimerQueue{};
+}
+
+QUuid TimerQueueTest::uuid(int index)
+{
+	return QUuid{static_cast<uint>(index + 1), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+}
+
+QList<int> TimerQueueTest::indexes(const QList<QUuid> &ids)
+{
+	QList<int> res;
+	res.reserve(ids.size());
+	for(const auto &id : ids)
+		res.append(static_cast<int>(id.data1) - 1);
+	return res;
+}
+
+QTEST_APPLESS_MAIN(TimerQueueTest)
+
+#include "tst_timerqueue.moc"
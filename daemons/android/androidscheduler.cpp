@@ -4,6 +4,7 @@
 #include <QAndroidJniExceptionCleaner>
 #include <chrono>
 #include <syncedsettings.h>
+#include <timezoneservice.h>
 
 AndroidScheduler::AndroidScheduler(QObject *parent) :
 	QObject(parent),
@@ -45,11 +46,15 @@ bool AndroidScheduler::scheduleReminder(const Reminder &reminder)
 	if(delay > 0)
 		trigger = trigger.addSecs(duration_cast<seconds>(minutes(delay)).count());
 
-	_jScheduler.callMethod<void>("createSchedule", "(Ljava/lang/String;IZJ)V",
+	// the system aligns alarms with overlapping windows to one wake up
+	const auto window = duration_cast<milliseconds>(minutes(SyncedSettings::instance()->scheduler.slack)).count();
+
+	_jScheduler.callMethod<void>("createSchedule", "(Ljava/lang/String;IZJJ)V",
 								 QAndroidJniObject::fromString(remKey).object<jstring>(),
 								 (jint)reminder.versionCode(),
 								 (jboolean)reminder.isImportant(),
-								 (jlong)trigger.toMSecsSinceEpoch());
+								 (jlong)TimeZoneService::instance()->toMSecsSinceEpoch(trigger),
+								 (jlong)window);
 	return true;
 }
 
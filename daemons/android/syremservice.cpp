@@ -51,10 +51,43 @@ void SyremService::openUrls(const Reminder &reminder) const
 
 void SyremService::dataResetted()
 {
-	// Android alarms cannot be easily canceled -> just let them be, they will do nothing as the corresponding reminders are deleted
-	_notifier->cleanNotifications();
-	LocalSettings::instance()->service.badgeActive.reset();
-	updateNotificationCount(0);
+	try {
+		const auto reminders = _store->loadAll();
+		const auto changes = ReminderIndex::diff(_scheduledVersions, reminders);
+		for(const auto &id : changes.removed) {
+			_scheduler->cancleReminder(id);
+			_notifier->removeNotification(id);
+			removeNotify(id);
+			_scheduledVersions.remove(id);
+		}
+
+		// notifications may also be left from earlier runs of the service, which are not in the table
+		QSet<QUuid> ids;
+		ids.reserve(reminders.size());
+		for(const auto &reminder : reminders)
+			ids.insert(reminder.id());
+		const QSet<QUuid> active = LocalSettings::instance()->service.badgeActive;
+		for(const auto &id : active) {
+			if(!ids.contains(id)) {
+				_notifier->removeNotification(id);
+				removeNotify(id);
+			}
+		}
+
+		for(const auto &reminder : changes.added)
+			doSchedule(reminder);
+		for(const auto &reminder : changes.updated)
+			doSchedule(reminder);
+		qDebug() << "Reconciled reminders after a reset with" << changes.added.size() << "added,"
+				 << changes.updated.size() << "updated and" << changes.removed.size() << "removed reminders";
+	} catch(QException &e) {
+		qCritical() << "Failed to reload reminders after a reset with error:" << e.what();
+		// Android alarms cannot be easily canceled -> just let them be, they will do nothing as the corresponding reminders are deleted
+		_notifier->cleanNotifications();
+		LocalSettings::instance()->service.badgeActive.reset();
+		updateNotificationCount(0);
+		_scheduledVersions.clear();
+	}
 }
 
 void SyremService::dataChanged(const QString &key, const QVariant &value)
@@ -69,6 +102,7 @@ void SyremService::dataChanged(const QString &key, const QVariant &value)
 		_scheduler->cancleReminder(id);
 		_notifier->removeNotification(id);
 		removeNotify(id);
+		_scheduledVersions.remove(id);
 	}
 }
 
@@ -295,6 +329,7 @@ QtService::Service::CommandMode SyremService::onStop(int &exitCode)
 
 void SyremService::doSchedule(const Reminder &reminder)
 {
+	_scheduledVersions.insert(reminder.id(), reminder.versionCode());
 	if(_scheduler->scheduleReminder(reminder)) {
 		_notifier->removeNotification(reminder.id());
 		removeNotify(reminder.id());
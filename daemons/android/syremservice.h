@@ -7,6 +7,7 @@
 #include <QtDataSync/SyncManager>
 #include <QtService/Service>
 #include <libsyrem.h>
+#include <reminderindex.h>
 #include <eventexpressionparser.h>
 #include <QAndroidIntent>
 #include <QQueue>
@@ -73,6 +74,8 @@ private:
 	QMutex _runMutex;
 	QList<Intent> _currentIntents;
 	QQueue<QList<int>> _doneStartIds;
+	// the versions of all reminders scheduled by this run of the service
+	QHash<QUuid, quint32> _scheduledVersions;
 
 	void doSchedule(const Reminder &reminder);
 
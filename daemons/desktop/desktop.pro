@@ -22,6 +22,8 @@ HEADERS += \
 	syremdaemon.h \
 	notificationmanager.h \
 	timerscheduler.h \
+	timerqueue.h \
+	wallclocktimer.h \
 	inotifier.h \
 	traysnoozeviewmodel.h \
 	traysnoozedialog.h
@@ -30,6 +32,8 @@ SOURCES += main.cpp \
 	syremdaemon.cpp \
 	notificationmanager.cpp \
 	timerscheduler.cpp \
+	timerqueue.cpp \
+	wallclocktimer.cpp \
 	traysnoozeviewmodel.cpp \
 	traysnoozedialog.cpp
 
@@ -13,6 +13,8 @@ public:
 
 public slots:
 	virtual void showNotification(const Reminder &reminder) = 0;
+	// one notification for all of the reminders
+	virtual void showNotifications(const QList<Reminder> &reminders) = 0;
 	virtual void removeNotification(QUuid id) = 0;
 
 	virtual void showErrorMessage(const QString &error) = 0;
@@ -21,6 +23,8 @@ public slots:
 
 signals:
 	virtual void messageCompleted(QUuid id, quint32 versionCode) = 0;
+	// the versions to complete are the ones of the passed reminders
+	virtual void messagesCompleted(const QList<Reminder> &reminders) = 0;
 	virtual void messageDelayed(QUuid id, quint32 versionCode, const QDateTime &nextTrigger) = 0;
 	virtual void messageActivated(QUuid id) = 0;
 	virtual void messageOpenUrls(QUuid id) = 0;
@@ -4,6 +4,8 @@
 #include <QtMvvmCore/CoreApp>
 #include <dialogmaster.h>
 #include <snoozeviewmodel.h>
+#include <algorithm>
+#include "traysnoozeviewmodel.h"
 
 #ifndef QT_NO_DEBUG
 #include <QIcon>
@@ -21,7 +23,8 @@ KdeNotifier::KdeNotifier(QObject *parent) :
 	INotifier(),
 	_settings(nullptr),
 	_parser(nullptr),
-	_notifications()
+	_notifications(),
+	_groups()
 {}
 
 void KdeNotifier::showNotification(const Reminder &reminder)
@@ -76,6 +79,50 @@ void KdeNotifier::showNotification(const Reminder &reminder)
 	notification->sendEvent();
 }
 
+void KdeNotifier::showNotifications(const QList<Reminder> &reminders)
+{
+	auto important = std::any_of(reminders.begin(), reminders.end(), [](const Reminder &reminder) {
+		return reminder.isImportant();
+	});
+	auto notification = new KNotification(QStringLiteral("remindgroup"),
+										  KNotification::Persistent | KNotification::SkipGrouping,
+										  this);
+	for(const auto &reminder : reminders)
+		_notifications.insert(reminder.id(), notification);
+	_groups.insert(notification, reminders);
+
+	updateGroup(notification);
+	notification->setNotifyIcon(Icon);
+	notification->setDefaultAction(tr("Open GUI"));
+	notification->setActions({
+		tr("Complete all"),
+		tr("Snooze")
+	});
+	if(important)
+		notification->setFlags(notification->flags() | KNotification::LoopSound);
+
+	connect(notification, QOverload<>::of(&KNotification::activated), this, [this, notification](){
+		auto group = removeGroup(notification);
+		if(!group.isEmpty())
+			emit messageActivated(group.first().id());
+	});
+	connect(notification, &KNotification::action1Activated, this, [this, notification](){
+		auto group = removeGroup(notification);
+		if(!group.isEmpty())
+			emit messagesCompleted(group);
+	});
+	connect(notification, &KNotification::action2Activated, this, [this, notification](){
+		auto group = removeGroup(notification);
+		if(!group.isEmpty())
+			QtMvvm::CoreApp::show<TraySnoozeViewModel>(TraySnoozeViewModel::showParams(this, group));
+	});
+	connect(notification, &KNotification::closed, this, [this, notification](){
+		removeGroup(notification);
+	});
+
+	notification->sendEvent();
+}
+
 void KdeNotifier::removeNotification(QUuid id)
 {
 	removeNot(id, true);
@@ -101,17 +148,20 @@ void KdeNotifier::showErrorMessage(const QString &error)
 
 void KdeNotifier::cancelAll()
 {
-	for(auto notification : qAsConst(_notifications)) {
+	// grouped notifications are registered for every reminder, but must only be closed once
+	const auto notifications = _notifications.values().toSet();
+	for(auto notification : notifications) {
 		notification->close();
 		notification->deleteLater();
 	}
 	_notifications.clear();
+	_groups.clear();
 }
 
 void KdeNotifier::qtmvvm_init()
 {
 	connect(qApp, &QApplication::aboutToQuit, this, [this](){
-		for(auto notification : qAsConst(_notifications))
+		for(auto notification : _notifications.values().toSet())
 			notification->close();
 	});
 }
@@ -120,6 +170,21 @@ bool KdeNotifier::removeNot(QUuid id, bool close)
 {
 	auto notification = _notifications.take(id);
 	if(notification) {
+		auto group = _groups.find(notification);
+		if(group != _groups.end()) {
+			// only close a group once none of it's reminders is left
+			auto &reminders = *group;
+			reminders.erase(std::remove_if(reminders.begin(), reminders.end(), [id](const Reminder &reminder) {
+				return reminder.id() == id;
+			}), reminders.end());
+			if(!reminders.isEmpty()) {
+				updateGroup(notification);
+				notification->update();
+				return true;
+			}
+			_groups.erase(group);
+		}
+
 		if(close)
 			notification->close();
 		notification->deleteLater();
@@ -127,3 +192,32 @@ bool KdeNotifier::removeNot(QUuid id, bool close)
 	} else
 		return false;
 }
+
+QList<Reminder> KdeNotifier::removeGroup(KNotification *notification, bool close)
+{
+	auto reminders = _groups.take(notification);
+	if(reminders.isEmpty())
+		return {};
+
+	for(const auto &reminder : qAsConst(reminders))
+		_notifications.remove(reminder.id());
+	if(close)
+		notification->close();
+	notification->deleteLater();
+	return reminders;
+}
+
+void KdeNotifier::updateGroup(KNotification *notification)
+{
+	const auto reminders = _groups.value(notification);
+	notification->setTitle(tr("%1 — %n Reminder(s)", "", reminders.size())
+						   .arg(QApplication::applicationDisplayName()));
+	QStringList lines;
+	lines.reserve(reminders.size());
+	for(const auto &reminder : reminders) {
+		lines.append(reminder.isImportant() ?
+						 tr("<b>%1</b>").arg(reminder.description().toHtmlEscaped()) :
+						 reminder.description().toHtmlEscaped());
+	}
+	notification->setText(lines.join(QStringLiteral("<br/>")));
+}
@@ -6,7 +6,10 @@
 #include <QProcess>
 #include <QStandardPaths>
 #include <chrono>
+#include <utility>
 #include <QCoreApplication>
+#include <timezoneservice.h>
+#include <localsettings.h>
 using namespace QtDataSync;
 
 Q_LOGGING_CATEGORY(manager, "manager")
@@ -20,8 +23,21 @@ NotificationManager::NotificationManager(QObject *parent) :
 	_settings(nullptr),
 	_manager(new SyncManager(this)),
 	_store(new ReminderStore(this)),
-	_activeIds()
+	_index(new ReminderIndex(this)),
+	_batch(new ReminderBatch(_store, this)),
+	_writeBuffer(new ReminderWriteBuffer(this)),
+	_activeIds(),
+	_triggered(),
+	_batchTimer(new QTimer(this))
 {
+	_writeBuffer->setDelay(std::chrono::milliseconds{LocalSettings::instance()->service.writeDelay});
+	connect(_batch, &ReminderBatch::written,
+			this, &NotificationManager::batchWritten);
+
+	_batchTimer->setSingleShot(true);
+	_batchTimer->setInterval(std::chrono::milliseconds{500});
+	connect(_batchTimer, &QTimer::timeout,
+			this, &NotificationManager::deliverTriggered);
 	connect(this, &NotificationManager::destroyed,
 			_taskbar->parent(), &QObject::deleteLater);
 }
@@ -35,6 +51,8 @@ void NotificationManager::qtmvvm_init()
 
 	connect(dynamic_cast<QObject*>(_notifier), SIGNAL(messageCompleted(QUuid,quint32)),
 			this, SLOT(messageCompleted(QUuid,quint32)));
+	connect(dynamic_cast<QObject*>(_notifier), SIGNAL(messagesCompleted(QList<Reminder>)),
+			this, SLOT(messagesCompleted(QList<Reminder>)));
 	connect(dynamic_cast<QObject*>(_notifier), SIGNAL(messageDelayed(QUuid,quint32,QDateTime)),
 			this, SLOT(messageDelayed(QUuid,quint32,QDateTime)));
 	connect(dynamic_cast<QObject*>(_notifier), SIGNAL(messageActivated(QUuid)),
@@ -46,12 +64,15 @@ void NotificationManager::qtmvvm_init()
 		_manager->runOnSynchronized([this](SyncManager::SyncState state) {
 			Q_UNUSED(state)
 			try {
-				_scheduler->initialize(_store->loadAll());
+				_index->attach(_store);
+				_scheduler->initialize(_index->dueReminders());
 
 				connect(_store, &DataTypeStoreBase::dataChanged,
 						this, &NotificationManager::dataChanged);
-				connect(_store, &DataTypeStoreBase::dataResetted,
+				connect(_index, &ReminderIndex::reconciled,
 						this, &NotificationManager::dataResetted);
+				connect(TimeZoneService::instance(), &TimeZoneService::systemZoneChanged,
+						this, &NotificationManager::systemZoneChanged);
 			} catch(QException &e) {
 				qCCritical(manager) << "Failed to load stored reminders with error:" << e.what();
 				_notifier->showErrorMessage(tr("Failed to load any reminders!"));
@@ -70,61 +91,127 @@ void NotificationManager::qtmvvm_init()
 void NotificationManager::triggerSync()
 {
 	qCInfo(manager) << "Reconnecting to remote server";
+	try {
+		_writeBuffer->flush();
+	} catch(QException &e) {
+		qCCritical(manager) << "Failed to write pending changes before syncing with error:" << e.what();
+	}
 	_manager->reconnect();
 }
 
 void NotificationManager::scheduleTriggered(QUuid id)
 {
-	try {
-		auto rem = _store->load(id);
-		_notifier->showNotification(rem);
-		addNotify(id);
-	} catch(QtDataSync::NoDataException &e) {
-		qCDebug(manager) << "Skipping presentation of deleted reminder" << id
-						<< "with reason" << e.what();
-	} catch(QException &e) {
-		qCCritical(manager) << "Failed to load reminder with id" << id
-							<< "to display notification with error:" << e.what();
-		//show error message here, because triggering a reminder failed -> get attention
-		_notifier->showErrorMessage(tr("Failed to load reminder to display notification!"));
+	if(!_triggered.contains(id))
+		_triggered.append(id);
+	// not restarted, so a constant stream of triggers cannot delay the first one
+	if(!_batchTimer->isActive())
+		_batchTimer->start();
+}
+
+void NotificationManager::deliverTriggered()
+{
+	const auto ids = std::exchange(_triggered, {});
+	if(ids.isEmpty())
+		return;
+
+	QList<Reminder> reminders;
+	reminders.reserve(ids.size());
+	for(const auto &id : ids) {
+		if(_index->contains(id))
+			reminders.append(_index->reminder(id));
+		else
+			qCDebug(manager) << "Skipping presentation of deleted reminder" << id;
+	}
+	if(reminders.isEmpty())
+		return;
+
+	if(reminders.size() > 1 && reminders.size() > _settings->gui.notifications.groupthreshold) {
+		qCInfo(manager) << "Showing" << reminders.size() << "triggered reminders as one group";
+		_notifier->showNotifications(reminders);
+	} else {
+		for(const auto &rem : qAsConst(reminders))
+			_notifier->showNotification(rem);
 	}
+
+	for(const auto &rem : qAsConst(reminders))
+		_activeIds.insert(rem.id());
+	updateNotificationCount();
 }
 
 void NotificationManager::messageCompleted(QUuid id, quint32 versionCode)
 {
+	if(!_index->contains(id)) {
+		qCDebug(manager) << "Skipping completing of deleted reminder" << id;
+		return;
+	}
+
 	try {
-		auto rem = _store->load(id);
+		auto rem = _index->reminder(id);
 		if(rem.versionCode() == versionCode) {
-			rem.nextSchedule(_store->store(), QDateTime::currentDateTime());
+			rem.nextSchedule(_writeBuffer, QDateTime::currentDateTime());
+			updateIndex(rem);
 			if(_settings->scheduler.urlOpen)
 				rem.openUrls();
 			qCInfo(manager) << "Completed reminder with id" << id;
 		}
 		removeNotify(id);
-	} catch(QtDataSync::NoDataException &e) {
-		qCDebug(manager) << "Skipping completing of deleted reminder" << id
-						<< "with reason" << e.what();
 	} catch(QException &e) {
 		qCCritical(manager) << "Failed to complete reminder with id" << id
 							<< "with error:" << e.what();
 	}
 }
 
+void NotificationManager::messagesCompleted(const QList<Reminder> &reminders)
+{
+	QList<Reminder> current;
+	current.reserve(reminders.size());
+	for(const auto &reminder : reminders) {
+		if(!_index->contains(reminder.id())) {
+			qCDebug(manager) << "Skipping completing of deleted reminder" << reminder.id();
+			continue;
+		}
+		auto rem = _index->reminder(reminder.id());
+		if(rem.versionCode() == reminder.versionCode())
+			current.append(rem);
+	}
+
+	try {
+		// buffered writes would otherwise overwrite the batch later
+		_writeBuffer->flush();
+		// one batch for all, the index and notifications are updated by batchWritten
+		_batch->complete(current, QDateTime::currentDateTime());
+		if(_settings->scheduler.urlOpen) {
+			for(const auto &rem : qAsConst(current))
+				rem.openUrls();
+		}
+		qCInfo(manager) << "Completed" << current.size() << "reminders";
+	} catch(QException &e) {
+		qCCritical(manager) << "Failed to complete" << current.size() << "reminders"
+							<< "with error:" << e.what();
+	}
+
+	for(const auto &reminder : reminders)
+		removeNotify(reminder.id());
+}
+
 void NotificationManager::messageDelayed(QUuid id, quint32 versionCode, const QDateTime &nextTrigger)
 {
 	if(!nextTrigger.isValid())
 		return;
 
+	if(!_index->contains(id)) {
+		qCDebug(manager) << "Skipping snoozing of deleted reminder" << id;
+		return;
+	}
+
 	try {
-		auto rem = _store->load(id);
+		auto rem = _index->reminder(id);
 		if(rem.versionCode() == versionCode) {
-			rem.performSnooze(_store->store(), nextTrigger);
+			rem.performSnooze(_writeBuffer, nextTrigger);
+			updateIndex(rem);
 			qCInfo(manager) << "Snoozed reminder with id" << id;
 		}
 		removeNotify(id);
-	} catch(QtDataSync::NoDataException &e) {
-		qCDebug(manager) << "Skipping snoozing of deleted reminder" << id
-						<< "with reason" << e.what();
 	} catch(QException &e) {
 		qCCritical(manager) << "Failed to snooze reminder with id" << id
 							<< "with error:" << e.what();
@@ -150,20 +237,17 @@ void NotificationManager::messageActivated(QUuid id)
 
 void NotificationManager::messageOpenUrls(QUuid id)
 {
-	try {
-		auto rem = _store->load(id);
-		rem.openUrls();
-	} catch(QtDataSync::NoDataException &e) {
-		qCDebug(manager) << "Skipping showing of URLs of deleted reminder" << id
-						 << "with reason" << e.what();
-	} catch(QException &e) {
-		qCCritical(manager) << "Failed to load reminder to open URLs with id" << id
-							<< "with error:" << e.what();
-	}
+	if(_index->contains(id))
+		_index->reminder(id).openUrls();
+	else
+		qCDebug(manager) << "Skipping showing of URLs of deleted reminder" << id;
 }
 
 void NotificationManager::dataChanged(const QString &key, const QVariant &value)
 {
+	if(_batch->wasWritten(key, value))
+		return;
+
 	if(value.isValid()) {
 		auto reminder = value.value<Reminder>();
 		removeNotify(reminder.id());
@@ -175,22 +259,55 @@ void NotificationManager::dataChanged(const QString &key, const QVariant &value)
 	}
 }
 
-void NotificationManager::dataResetted()
+void NotificationManager::dataResetted(const ReminderIndex::Changes &changes)
 {
-	_scheduler->cancelAll();
-	_notifier->cancelAll();
-	_activeIds.clear();
-	updateNotificationCount();
+	// pending writes are based on the data from before the reset. The ones still newer are written
+	// after the reset versions were scheduled, so their store signals replace them
+	_writeBuffer->discardOutdated(changes.added + changes.updated, changes.removed);
+
+	// reminders that did not change keep their timers and notifications
+	for(const auto &id : changes.removed) {
+		_scheduler->cancleReminder(id);
+		removeNotify(id);
+	}
+	for(const auto &reminder : changes.updated) {
+		removeNotify(reminder.id());
+		_scheduler->scheduleReminder(reminder);
+	}
+	for(const auto &reminder : changes.added)
+		_scheduler->scheduleReminder(reminder);
+
+	qCInfo(manager) << "Reconciled reminders after a reset with" << changes.added.size() << "added,"
+					<< changes.updated.size() << "updated and" << changes.removed.size() << "removed reminders";
+
+	try {
+		_writeBuffer->flush();
+	} catch(QException &e) {
+		qCCritical(manager) << "Failed to write pending changes after a reset with error:" << e.what();
+	}
 }
 
-void NotificationManager::addNotify(QUuid id)
+void NotificationManager::batchWritten(const QList<Reminder> &saved, const QList<QUuid> &removed)
 {
-	if(!_activeIds.contains(id)) {
-		_activeIds.insert(id);
-		updateNotificationCount();
+	for(const auto &reminder : saved) {
+		updateIndex(reminder);
+		removeNotify(reminder.id());
+		_scheduler->scheduleReminder(reminder);
+	}
+	for(const auto &id : removed) {
+		_index->remove(id);
+		_scheduler->cancleReminder(id);
+		removeNotify(id);
 	}
 }
 
+void NotificationManager::systemZoneChanged()
+{
+	qCInfo(manager) << "System timezone changed to" << TimeZoneService::instance()->systemZone().id()
+					<< "- rescheduling all reminders";
+	_scheduler->rescheduleAll(_index->dueReminders());
+}
+
 void NotificationManager::removeNotify(QUuid id)
 {
 	_notifier->removeNotification(id);
@@ -198,6 +315,23 @@ void NotificationManager::removeNotify(QUuid id)
 		updateNotificationCount();
 }
 
+void NotificationManager::updateIndex(const Reminder &reminder)
+{
+	// the store signals follow later, but following actions must already see the new version
+	if(reminder.current().isValid())
+		_index->insert(reminder);
+	else
+		_index->remove(reminder.id());
+
+	// for buffered writes, the store signals can take longer than the next trigger
+	if(_writeBuffer->isPending(reminder.id())) {
+		if(reminder.current().isValid())
+			_scheduler->scheduleReminder(reminder);
+		else
+			_scheduler->cancleReminder(reminder.id());
+	}
+}
+
 void NotificationManager::updateNotificationCount()
 {
 	auto nValue = _activeIds.count();
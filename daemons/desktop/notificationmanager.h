@@ -2,11 +2,15 @@
 #define NOTIFICATIONMANAGER_H
 
 #include <QObject>
+#include <QTimer>
 #include <QtDataSync/SyncManager>
 #include <QtDataSync/DataTypeStore>
 #include <QtMvvmCore/Injection>
 #include <qtaskbarcontrol.h>
 #include <syncedsettings.h>
+#include <reminderindex.h>
+#include <reminderbatch.h>
+#include <reminderwritebuffer.h>
 #include "timerscheduler.h"
 #include "inotifier.h"
 #include "libsyrem.h"
@@ -27,14 +31,18 @@ public slots:
 
 private slots:
 	void scheduleTriggered(QUuid id);
+	void deliverTriggered();
 
 	void messageCompleted(QUuid id, quint32 versionCode);
+	void messagesCompleted(const QList<Reminder> &reminders);
 	void messageDelayed(QUuid id, quint32 versionCode, const QDateTime &nextTrigger);
 	void messageActivated(QUuid id);
 	void messageOpenUrls(QUuid id);
 
 	void dataChanged(const QString &key, const QVariant &value);
-	void dataResetted();
+	void dataResetted(const ReminderIndex::Changes &changes);
+	void batchWritten(const QList<Reminder> &saved, const QList<QUuid> &removed);
+	void systemZoneChanged();
 
 private:
 	TimerScheduler *_scheduler;
@@ -44,9 +52,18 @@ private:
 
 	QtDataSync::SyncManager *_manager;
 	ReminderStore *_store;
+	// every stored reminder, kept up to date by the store signals. The store is only used for writes
+	ReminderIndex *_index;
+	ReminderBatch *_batch;
+	// single completes and snoozes, so quick successive ones are written only once
+	ReminderWriteBuffer *_writeBuffer;
 	QSet<QUuid> _activeIds;
+	// triggers are collected for a short time, so they can be presented together
+	QList<QUuid> _triggered;
+	QTimer *_batchTimer;
+
+	void updateIndex(const Reminder &reminder);
 
-	void addNotify(QUuid id);
 	void removeNotify(QUuid id);
 	void updateNotificationCount();
 };
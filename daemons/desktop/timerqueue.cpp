@@ -0,0 +1,409 @@
+#include "timerqueue.h"
+#include <QDateTime>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+using namespace std::chrono;
+
+namespace {
+
+constexpr qint64 MinuteMSecs = duration_cast<milliseconds>(minutes{1}).count();
+constexpr qint64 MinutesPerHour = duration_cast<minutes>(hours{1}).count();
+constexpr qint64 HoursPerDay = 24;
+constexpr qint64 MinutesPerDay = MinutesPerHour * HoursPerDay;
+
+// rounding down for negative values as well
+qint64 floorDiv(qint64 value, qint64 divisor)
+{
+	auto res = value / divisor;
+	if(value % divisor < 0)
+		--res;
+	return res;
+}
+
+int floorMod(qint64 value, qint64 divisor)
+{
+	auto res = value % divisor;
+	if(res < 0)
+		res += divisor;
+	return static_cast<int>(res);
+}
+
+qint64 nextBoundary(qint64 minute, qint64 step)
+{
+	return (floorDiv(minute, step) + 1) * step;
+}
+
+}
+
+constexpr qint64 TimerQueue::NoDue;
+constexpr int WheelTimerQueue::DaySlots;
+
+void HeapTimerQueue::insert(const QUuid &id, qint64 due)
+{
+	auto it = _index.find(id);
+	if(it != _index.end()) {
+		const auto index = *it;
+		const auto oldDue = _heap[index].due;
+		_heap[index].due = due;
+		if(due < oldDue)
+			siftUp(index);
+		else
+			siftDown(index);
+	} else {
+		_heap.append({due, id});
+		_index.insert(id, _heap.size() - 1);
+		siftUp(_heap.size() - 1);
+	}
+}
+
+bool HeapTimerQueue::remove(const QUuid &id)
+{
+	const auto index = _index.value(id, -1);
+	if(index == -1)
+		return false;
+	removeAt(index);
+	return true;
+}
+
+void HeapTimerQueue::clear()
+{
+	_heap.clear();
+	_index.clear();
+}
+
+int HeapTimerQueue::size() const
+{
+	return _heap.size();
+}
+
+bool HeapTimerQueue::contains(const QUuid &id) const
+{
+	return _index.contains(id);
+}
+
+qint64 HeapTimerQueue::nextDue() const
+{
+	return _heap.isEmpty() ? NoDue : _heap.first().due;
+}
+
+QList<QUuid> HeapTimerQueue::takeDue(qint64 now)
+{
+	QList<QUuid> due;
+	while(!_heap.isEmpty() && _heap.first().due <= now) {
+		due.append(_heap.first().id);
+		removeAt(0);
+	}
+	return due;
+}
+
+void HeapTimerQueue::removeAt(int index)
+{
+	_index.remove(_heap[index].id);
+	const auto last = _heap.takeLast();
+	if(index == _heap.size()) // was the last one
+		return;
+
+	// fill the gap with the last entry and restore the order in whichever direction it is broken
+	const auto oldDue = _heap[index].due;
+	moveTo(index, last);
+	if(last.due < oldDue)
+		siftUp(index);
+	else
+		siftDown(index);
+}
+
+void HeapTimerQueue::moveTo(int index, Entry entry)
+{
+	_index[entry.id] = index;
+	_heap[index] = std::move(entry);
+}
+
+void HeapTimerQueue::siftUp(int index)
+{
+	const auto entry = _heap[index];
+	while(index > 0) {
+		const auto parent = (index - 1) / 2;
+		if(_heap[parent].due <= entry.due)
+			break;
+		moveTo(index, _heap[parent]);
+		index = parent;
+	}
+	moveTo(index, entry);
+}
+
+void HeapTimerQueue::siftDown(int index)
+{
+	const auto entry = _heap[index];
+	const auto count = _heap.size();
+	forever {
+		auto child = index * 2 + 1;
+		if(child >= count)
+			break;
+		if(child + 1 < count && _heap[child + 1].due < _heap[child].due)
+			++child;
+		if(entry.due <= _heap[child].due)
+			break;
+		moveTo(index, _heap[child]);
+		index = child;
+	}
+	moveTo(index, entry);
+}
+
+
+
+WheelTimerQueue::WheelTimerQueue()
+{
+	_wheels[MinuteLevel].resize(MinutesPerHour);
+	_wheels[HourLevel].resize(HoursPerDay);
+	_wheels[DayLevel].resize(DaySlots);
+	resetMinute();
+}
+
+void WheelTimerQueue::insert(const QUuid &id, qint64 due)
+{
+	auto it = _entries.find(id);
+	if(it != _entries.end())
+		unplace(id, *it);
+	else if(_entries.isEmpty())
+		resetMinute(); // the wheel may have been moved far ahead
+	place(id, due);
+}
+
+bool WheelTimerQueue::remove(const QUuid &id)
+{
+	auto it = _entries.find(id);
+	if(it == _entries.end())
+		return false;
+
+	unplace(id, *it);
+	_entries.erase(it);
+	return true;
+}
+
+void WheelTimerQueue::clear()
+{
+	_entries.clear();
+	for(auto &wheel : _wheels) {
+		for(auto &bucket : wheel)
+			bucket.clear();
+	}
+	for(auto &dues : _dues)
+		dues.clear();
+	resetMinute();
+}
+
+int WheelTimerQueue::size() const
+{
+	return _entries.size();
+}
+
+bool WheelTimerQueue::contains(const QUuid &id) const
+{
+	return _entries.contains(id);
+}
+
+qint64 WheelTimerQueue::nextDue() const
+{
+	// every level only covers the time after the one below, so the first used one has the earliest entry
+	for(const auto &dues : _dues) {
+		if(!dues.isEmpty())
+			return dues.firstKey();
+	}
+	return NoDue;
+}
+
+QList<QUuid> WheelTimerQueue::takeDue(qint64 now)
+{
+	QSet<QUuid> dueIds;
+	const auto minute = floorDiv(now, MinuteMSecs);
+	if(minute > _minute)
+		advanceTo(minute, dueIds);
+
+	// the current minute may still contain entries that are due later within the minute
+	auto &minuteDues = _dues[MinuteLevel];
+	auto &current = _wheels[MinuteLevel][floorMod(_minute, MinutesPerHour)];
+	for(auto it = minuteDues.begin(); it != minuteDues.end() && it.key() <= now;) {
+		dueIds.insert(*it);
+		current.remove(*it);
+		it = minuteDues.erase(it);
+	}
+
+	QVector<std::pair<qint64, QUuid>> sorted;
+	sorted.reserve(dueIds.size());
+	for(const auto &id : qAsConst(dueIds))
+		sorted.append({_entries.take(id).due, id});
+	std::sort(sorted.begin(), sorted.end());
+
+	QList<QUuid> due;
+	due.reserve(sorted.size());
+	for(const auto &entry : qAsConst(sorted))
+		due.append(entry.second);
+	return due;
+}
+
+void WheelTimerQueue::place(const QUuid &id, qint64 due)
+{
+	Entry entry {due, MinuteLevel, 0};
+	const auto minute = floorDiv(due, MinuteMSecs);
+	const auto hour = floorDiv(minute, MinutesPerHour);
+	const auto day = floorDiv(hour, HoursPerDay);
+	const auto currentHour = floorDiv(_minute, MinutesPerHour);
+	const auto currentDay = floorDiv(currentHour, HoursPerDay);
+	if(minute <= _minute) // already passed, so it is taken with the current minute
+		entry.slot = floorMod(_minute, MinutesPerHour);
+	else if(hour == currentHour)
+		entry.slot = floorMod(minute, MinutesPerHour);
+	else if(day == currentDay) {
+		entry.level = HourLevel;
+		entry.slot = floorMod(hour, HoursPerDay);
+	} else if(floorDiv(day, DaySlots) == floorDiv(currentDay, DaySlots)) { // within the current rotation
+		entry.level = DayLevel;
+		entry.slot = floorMod(day, DaySlots);
+	} else
+		entry.level = OverflowLevel;
+
+	if(entry.level != OverflowLevel)
+		_wheels[entry.level][entry.slot].insert(id);
+	_dues[entry.level].insert(due, id);
+	_entries.insert(id, entry);
+}
+
+void WheelTimerQueue::unplace(const QUuid &id, const Entry &entry)
+{
+	if(entry.level != OverflowLevel)
+		_wheels[entry.level][entry.slot].remove(id);
+	_dues[entry.level].remove(entry.due, id);
+}
+
+void WheelTimerQueue::cascade(const QList<QUuid> &ids)
+{
+	for(const auto &id : ids)
+		place(id, _entries.value(id).due);
+}
+
+QSet<QUuid> WheelTimerQueue::takeSlot(Level level, int slot)
+{
+	auto bucket = std::exchange(_wheels[level][slot], QSet<QUuid>{});
+	for(const auto &id : qAsConst(bucket))
+		_dues[level].remove(_entries.value(id).due, id);
+	return bucket;
+}
+
+void WheelTimerQueue::advanceTo(qint64 minute, QSet<QUuid> &due)
+{
+	while(_minute < minute) {
+		// everything of a passed minute is due
+		due.unite(takeSlot(MinuteLevel, floorMod(_minute, MinutesPerHour)));
+
+		// skip the empty parts of the wheel, but stop where a level needs to be cascaded
+		auto next = _minute + 1;
+		if(_dues[MinuteLevel].isEmpty()) {
+			next = nextBoundary(_minute, MinutesPerHour);
+			if(_dues[HourLevel].isEmpty()) {
+				next = nextBoundary(_minute, MinutesPerDay);
+				if(_dues[DayLevel].isEmpty()) {
+					next = _dues[OverflowLevel].isEmpty() ?
+							   minute :
+							   nextBoundary(_minute, MinutesPerDay * DaySlots);
+				}
+			}
+		}
+		_minute = std::min(next, minute);
+
+		if(floorMod(_minute, MinutesPerHour) != 0)
+			continue;
+		const auto hour = floorDiv(_minute, MinutesPerHour);
+		if(floorMod(hour, HoursPerDay) == 0) {
+			const auto day = floorDiv(hour, HoursPerDay);
+			if(floorMod(day, DaySlots) == 0) // the overflow moves into the day wheel once per rotation
+				cascade(std::exchange(_dues[OverflowLevel], QMultiMap<qint64, QUuid>{}).values());
+			cascade(takeSlot(DayLevel, floorMod(day, DaySlots)).values());
+		}
+		cascade(takeSlot(HourLevel, floorMod(hour, HoursPerDay)).values());
+	}
+}
+
+void WheelTimerQueue::resetMinute()
+{
+	_minute = floorDiv(QDateTime::currentMSecsSinceEpoch(), MinuteMSecs);
+}
+
+
+
+CoalescingTimerQueue::CoalescingTimerQueue(TimerQueue *exactQueue, TimerQueue *slackQueue) :
+	_exactQueue{exactQueue},
+	_slackQueue{slackQueue}
+{}
+
+void CoalescingTimerQueue::insert(const QUuid &id, qint64 due, bool exact)
+{
+	remove(id);
+	_dues.insert(id, due);
+	if(exact)
+		_exactQueue->insert(id, due);
+	else
+		_slackQueue->insert(id, due);
+}
+
+bool CoalescingTimerQueue::remove(const QUuid &id)
+{
+	if(_dues.remove(id) == 0)
+		return false;
+	if(!_exactQueue->remove(id))
+		_slackQueue->remove(id);
+	return true;
+}
+
+void CoalescingTimerQueue::clear()
+{
+	_exactQueue->clear();
+	_slackQueue->clear();
+	_dues.clear();
+}
+
+bool CoalescingTimerQueue::isEmpty() const
+{
+	return _dues.isEmpty();
+}
+
+qint64 CoalescingTimerQueue::nextWakeUp(qint64 slack) const
+{
+	return std::min(_exactQueue->nextDue(), slackDeadline(slack));
+}
+
+QList<QUuid> CoalescingTimerQueue::takeDue(qint64 now, qint64 slack)
+{
+	auto ids = _exactQueue->takeDue(now);
+	const auto exactWakeUp = !ids.isEmpty();
+	if(!exactWakeUp && now < slackDeadline(slack))
+		return ids;
+
+	QSet<qint64> exactDues;
+	for(const auto &id : qAsConst(ids))
+		exactDues.insert(_dues.take(id));
+	// every other due time would have needed a wake up of it's own
+	QSet<qint64> slackDues;
+	for(const auto &id : _slackQueue->takeDue(now)) {
+		const auto due = _dues.take(id);
+		if(!exactDues.contains(due))
+			slackDues.insert(due);
+		ids.append(id);
+	}
+	if(!slackDues.isEmpty())
+		_savedWakeUps += static_cast<quint64>(exactWakeUp ? slackDues.size() : slackDues.size() - 1);
+	return ids;
+}
+
+quint64 CoalescingTimerQueue::savedWakeUps() const
+{
+	return _savedWakeUps;
+}
+
+qint64 CoalescingTimerQueue::slackDeadline(qint64 slack) const
+{
+	const auto first = _slackQueue->nextDue();
+	if(first > TimerQueue::NoDue - slack)
+		return TimerQueue::NoDue;
+	return first + slack;
+}
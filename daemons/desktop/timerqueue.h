@@ -0,0 +1,146 @@
+#ifndef TIMERQUEUE_H
+#define TIMERQUEUE_H
+
+#include <QHash>
+#include <QList>
+#include <QMultiMap>
+#include <QScopedPointer>
+#include <QUuid>
+#include <QSet>
+#include <QVector>
+#include <array>
+#include <limits>
+
+// pending due times of the scheduled reminders, in utc msecs
+class TimerQueue
+{
+public:
+	static constexpr qint64 NoDue = std::numeric_limits<qint64>::max();
+
+	virtual inline ~TimerQueue() = default;
+
+	// replaces the due time if the id is already queued
+	virtual void insert(const QUuid &id, qint64 due) = 0;
+	virtual bool remove(const QUuid &id) = 0;
+	virtual void clear() = 0;
+
+	virtual int size() const = 0;
+	virtual bool contains(const QUuid &id) const = 0;
+	// earliest due time, or NoDue if empty
+	virtual qint64 nextDue() const = 0;
+	// removes all entries that are due at the given time, the earliest first
+	virtual QList<QUuid> takeDue(qint64 now) = 0;
+
+	inline bool isEmpty() const {
+		return size() == 0;
+	}
+};
+
+// indexed binary min heap, all operations are O(log n)
+class HeapTimerQueue : public TimerQueue
+{
+public:
+	void insert(const QUuid &id, qint64 due) override;
+	bool remove(const QUuid &id) override;
+	void clear() override;
+
+	int size() const override;
+	bool contains(const QUuid &id) const override;
+	qint64 nextDue() const override;
+	QList<QUuid> takeDue(qint64 now) override;
+
+private:
+	struct Entry {
+		qint64 due;
+		QUuid id;
+	};
+
+	QVector<Entry> _heap;
+	QHash<QUuid, int> _index;
+
+	void removeAt(int index);
+	void moveTo(int index, Entry entry);
+	void siftUp(int index);
+	void siftDown(int index);
+};
+
+// hierarchical timing wheel with minute, hour and day buckets, that are cascaded down as time passes.
+// Each level also keeps it's due times ordered, so the next due time is the first one of the first used
+// level. Inserting and removing is logarithmic in the size of the level, cascading is done per bucket
+class WheelTimerQueue : public TimerQueue
+{
+public:
+	WheelTimerQueue();
+
+	void insert(const QUuid &id, qint64 due) override;
+	bool remove(const QUuid &id) override;
+	void clear() override;
+
+	int size() const override;
+	bool contains(const QUuid &id) const override;
+	qint64 nextDue() const override;
+	QList<QUuid> takeDue(qint64 now) override;
+
+private:
+	enum Level : quint8 {
+		MinuteLevel,
+		HourLevel,
+		DayLevel,
+		OverflowLevel
+	};
+
+	struct Entry {
+		qint64 due;
+		Level level;
+		int slot;
+	};
+
+	static constexpr int DaySlots = 64;
+
+	QHash<QUuid, Entry> _entries;
+	std::array<QVector<QSet<QUuid>>, OverflowLevel> _wheels;
+	// the overflow has no buckets, only the ordered dues
+	std::array<QMultiMap<qint64, QUuid>, OverflowLevel + 1> _dues;
+	// all minutes before this one have been taken
+	qint64 _minute;
+
+	void place(const QUuid &id, qint64 due);
+	void unplace(const QUuid &id, const Entry &entry);
+	void cascade(const QList<QUuid> &ids);
+	QSet<QUuid> takeSlot(Level level, int slot);
+	void advanceTo(qint64 minute, QSet<QUuid> &due);
+	void resetMinute();
+};
+
+// an exact queue for important reminders and one for all others, that may be delayed by the slack. A wake up
+// for the others is only needed at the end of the slack after the first of them, and triggers all that are
+// due by then. A wake up for an exact one triggers all due others as well
+class CoalescingTimerQueue
+{
+public:
+	CoalescingTimerQueue(TimerQueue *exactQueue, TimerQueue *slackQueue);
+
+	// replaces the due time if the id is already queued, in either queue
+	void insert(const QUuid &id, qint64 due, bool exact);
+	bool remove(const QUuid &id);
+	void clear();
+
+	bool isEmpty() const;
+	// the time to wake up at, or TimerQueue::NoDue if empty
+	qint64 nextWakeUp(qint64 slack) const;
+	// removes all entries that a wake up at the given time triggers
+	QList<QUuid> takeDue(qint64 now, qint64 slack);
+
+	// wake ups that were not needed, because entries with different due times were triggered together
+	quint64 savedWakeUps() const;
+
+private:
+	QScopedPointer<TimerQueue> _exactQueue;
+	QScopedPointer<TimerQueue> _slackQueue;
+	QHash<QUuid, qint64> _dues;
+	quint64 _savedWakeUps = 0;
+
+	qint64 slackDeadline(qint64 slack) const;
+};
+
+#endif // TIMERQUEUE_H
@@ -1,7 +1,11 @@
 #include "timerscheduler.h"
 #include <QDebug>
-#include <QEvent>
 #include <QLoggingCategory>
+#include <QtConcurrentMap>
+#include <localsettings.h>
+#include <syncedsettings.h>
+#include <timezoneservice.h>
+#include <algorithm>
 #include <chrono>
 using namespace std::chrono;
 
@@ -10,16 +14,56 @@ Q_LOGGING_CATEGORY(scheduler, "scheduler")
 TimerScheduler::TimerScheduler(QObject *parent) :
 	QObject(parent),
 	_schedules(),
-	_loopTimerId(startTimer(minutes(50), Qt::VeryCoarseTimer))
+	_queue(createQueue(), createQueue()),
+	_timer(new WallClockTimer(this))
 {
-	if(_loopTimerId == 0)
-		qCCritical(scheduler) << "Failed to start main timer loop";
+	connect(_timer, &WallClockTimer::timeout,
+			this, &TimerScheduler::triggerDue);
+	// the queue only knows absolute times, so only what is due by the new time needs to be triggered
+	connect(_timer, &WallClockTimer::clockChanged,
+			this, &TimerScheduler::triggerDue);
+	if(!_timer->detectsClockChanges())
+		qCDebug(scheduler) << "Changes of the system clock are only noticed with the next wake up";
+	arm();
 }
 
-void TimerScheduler::initialize(const QList<Reminder> &allReminders)
+void TimerScheduler::initialize(const QList<Reminder> &dueReminders)
 {
-	for(const auto& rem : allReminders)
-		scheduleReminder(rem);
+	// same as scheduleReminder for each, but the timer is only armed once
+	for(const auto& rem : dueReminders) {
+		const auto current = _schedules.value(rem.id());
+		if(current.date.isValid() && current.version == rem.versionCode())
+			continue;
+		cancel(rem.id());
+		schedule(rem, dueTime(rem));
+	}
+	arm();
+	qCInfo(scheduler) << "Scheduled" << dueReminders.size() << "reminders";
+}
+
+void TimerScheduler::rescheduleAll(const QList<Reminder> &allReminders)
+{
+	// the wall times stay the same, but the zone may have moved them to another point in time
+	const auto dues = QtConcurrent::blockingMapped<QVector<qint64>>(allReminders, &TimerScheduler::dueTime);
+
+	auto changed = 0;
+	for(auto i = 0; i < allReminders.size(); ++i) {
+		const auto &reminder = allReminders[i];
+		if(!reminder.current().isValid())
+			continue;
+
+		auto current = _schedules.value(reminder.id());
+		if(current.date.isValid() &&
+		   current.version == reminder.versionCode() &&
+		   current.due == dues[i])
+			continue;
+
+		cancel(reminder.id());
+		schedule(reminder, dues[i]);
+		++changed;
+	}
+	arm();
+	qCInfo(scheduler) << "Rescheduled" << changed << "of" << allReminders.size() << "reminders";
 }
 
 void TimerScheduler::scheduleReminder(const Reminder &reminder)
@@ -33,92 +77,103 @@ void TimerScheduler::scheduleReminder(const Reminder &reminder)
 		return;
 	}
 
-	cancleReminder(reminder.id());
-	auto tId = trySchedule(reminder.current(), reminder.id());
-	if(tId == -1)
-		emit scheduleTriggered(reminder.id());
-	else
-		_schedules.insert(reminder.id(), {reminder.versionCode(), reminder.current(), tId});
-	return;
+	cancel(reminder.id());
+	schedule(reminder, dueTime(reminder));
+	arm();
 }
 
 void TimerScheduler::cancleReminder(QUuid id)
 {
-	auto tInfo = _schedules.take(id);
-	if(tInfo.date.isValid() && tInfo.timerId != 0) {
-		qCDebug(scheduler) << "Canceled timer for reminder with id" << id;
-		killTimer(tInfo.timerId);
-	}
+	if(cancel(id))
+		arm();
 }
 
 void TimerScheduler::cancelAll()
 {
-	for(const auto &sched : qAsConst(_schedules))
-		killTimer(sched.timerId);
 	_schedules.clear();
+	_queue.clear();
+	arm();
 	qCDebug(scheduler) << "Cleared all active schedules";
 }
 
-
-void TimerScheduler::timerEvent(QTimerEvent *event)
+void TimerScheduler::triggerDue()
 {
-	auto timerId = event->timerId();
-	if(timerId == _loopTimerId)
-		reschedule();
-	else {
-		for(auto it = _schedules.begin(); it != _schedules.end(); it++) {
-			if(it->timerId == timerId) {
-				killTimer(timerId);
-
-				auto tDiff = qAbs(it->date.secsTo(QDateTime::currentDateTime()));
-				if(tDiff > 60) {
-					qCWarning(scheduler) << "Timer triggered with great target time difference of" << tDiff
-										 << "seconds for reminder with id" << it.key();
-				} else
-					qCInfo(scheduler) << "Timer triggered for reminder with id" << it.key();
-
-				emit scheduleTriggered(it.key());
-				_schedules.erase(it);
-				return;
-			}
-		}
-
-		qCWarning(scheduler) << "Timer triggered, but no schedule matches the ID";
-		killTimer(timerId);
+	// without a watcher, every wake up checks the zone, so nothing is triggered for outdated times
+	const auto zones = TimeZoneService::instance();
+	if(!zones->watchesSystemZone())
+		zones->checkSystemZone();
+
+	const auto now = QDateTime::currentMSecsSinceEpoch();
+	const auto slackMSecs = slack();
+	const auto savedWakeUps = _queue.savedWakeUps();
+	const auto dueIds = _queue.takeDue(now, slackMSecs);
+	if(dueIds.isEmpty() && zones->watchesSystemZone()) // only waited for the maximum interval, in case the watcher missed a change
+		zones->checkSystemZone();
+
+	if(_queue.savedWakeUps() != savedWakeUps) {
+		qCInfo(scheduler) << "Triggering" << dueIds.size() << "reminders with one wake up, saved"
+						  << _queue.savedWakeUps() << "wake ups so far";
+	}
+	for(const auto &id : qAsConst(dueIds)) {
+		const auto info = _schedules.take(id);
+		const auto tDiff = (now - info.due) / 1000;
+		if(tDiff > 60 + slackMSecs / 1000) {
+			qCWarning(scheduler) << "Timer triggered with great target time difference of" << tDiff
+								 << "seconds for reminder with id" << id;
+		} else
+			qCInfo(scheduler) << "Timer triggered for reminder with id" << id;
+		emit scheduleTriggered(id);
 	}
+
+	arm();
 }
 
-void TimerScheduler::reschedule()
+TimerQueue *TimerScheduler::createQueue()
 {
-	qCDebug(scheduler) << "Rescheduling timers for the near future";
-	for(auto it = _schedules.begin(); it != _schedules.end();) {
-		if(it->timerId == 0) {
-			it->timerId = trySchedule(it->date, it.key());
-			if(it->timerId == -1) {//trigger now, as it's in the past
-				emit scheduleTriggered(it.key());
-				it = _schedules.erase(it);
-				continue;
-			}
-		}
-		it++;
-	}
+	if(LocalSettings::instance()->service.timingWheel) {
+		qCDebug(scheduler) << "Using a timing wheel to schedule reminders";
+		return new WheelTimerQueue{};
+	} else
+		return new HeapTimerQueue{};
 }
 
-int TimerScheduler::trySchedule(const QDateTime &target, QUuid id)
+qint64 TimerScheduler::dueTime(const Reminder &reminder)
 {
-	auto secs = QDateTime::currentDateTime().secsTo(target);
-	if(secs <= 0) {
-		qCInfo(scheduler) << "Immediatly triggering scheduled reminder with id" << id << "due to overtime" ;
-		return -1;
-	}
-	else if(seconds(secs) < hours(1)) { //only schedule "close" events
-		qCInfo(scheduler) << "Scheduling near future reminder" << id << "for in" << secs << "seconds";
-		auto id = startTimer(duration_cast<milliseconds>(seconds(secs)).count(), Qt::VeryCoarseTimer);
-		if(id == 0)
-			qCCritical(scheduler) << "Failed to start timer for reminder" << id << "at" << target;
-		return id;
+	// resolved from the wall time, so it is always based on the current zone
+	const auto current = reminder.current();
+	return TimeZoneService::instance()->toMSecsSinceEpoch(current.date(), current.time());
+}
+
+qint64 TimerScheduler::slack()
+{
+	return duration_cast<milliseconds>(minutes{SyncedSettings::instance()->scheduler.slack}).count();
+}
+
+void TimerScheduler::schedule(const Reminder &reminder, qint64 due)
+{
+	if(due <= QDateTime::currentMSecsSinceEpoch()) {
+		qCInfo(scheduler) << "Immediatly triggering scheduled reminder with id" << reminder.id() << "due to overtime" ;
+		emit scheduleTriggered(reminder.id());
 	} else {
-		qCDebug(scheduler) << "Postponing scheduling for" << id << "as it is in the far future";
-		return 0;
+		qCDebug(scheduler) << "Scheduling reminder" << reminder.id() << "for" << reminder.current();
+		_schedules.insert(reminder.id(), {reminder.versionCode(), reminder.current(), due});
+		_queue.insert(reminder.id(), due, reminder.isImportant());
 	}
 }
+
+bool TimerScheduler::cancel(const QUuid &id)
+{
+	if(_schedules.remove(id) == 0)
+		return false;
+	_queue.remove(id);
+	qCDebug(scheduler) << "Canceled timer for reminder with id" << id;
+	return true;
+}
+
+void TimerScheduler::arm()
+{
+	// wake up at least every 50 minutes, so relative timers can never drift too far away
+	const auto maxInterval = duration_cast<milliseconds>(minutes{50}).count();
+	_timer->start(std::min(_queue.nextWakeUp(slack()),
+						   QDateTime::currentMSecsSinceEpoch() + maxInterval));
+}
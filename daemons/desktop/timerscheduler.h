@@ -2,8 +2,9 @@
 #define WIDGETSSCHEDULER_H
 
 #include <QObject>
-#include <QTimer>
 #include <reminder.h>
+#include "timerqueue.h"
+#include "wallclocktimer.h"
 
 class TimerScheduler : public QObject
 {
@@ -13,7 +14,9 @@ public:
 	explicit TimerScheduler(QObject *parent = nullptr);
 
 public slots:
-	void initialize(const QList<Reminder> &allReminders);
+	// expects only reminders with a due time, as ReminderIndex::dueReminders returns them
+	void initialize(const QList<Reminder> &dueReminders);
+	void rescheduleAll(const QList<Reminder> &allReminders);
 	void scheduleReminder(const Reminder &reminder);
 	void cancleReminder(QUuid id);
 
@@ -22,21 +25,28 @@ public slots:
 signals:
 	void scheduleTriggered(const QUuid &id);
 
-protected:
-	void timerEvent(QTimerEvent *event) override;
+private slots:
+	void triggerDue();
 
 private:
 	struct SchedInfo {
 		quint32 version;
 		QDateTime date;
-		int timerId;
+		qint64 due;
 	};
 	QHash<QUuid, SchedInfo> _schedules;
-
-	int _loopTimerId;
-
-	void reschedule();
-	int trySchedule(const QDateTime &target, QUuid id);
+	// only the next wake up is waited for by the single timer. Non important reminders may be delayed
+	// by the slack, so they share a wake up
+	CoalescingTimerQueue _queue;
+	WallClockTimer *_timer;
+
+	static TimerQueue *createQueue();
+	static qint64 dueTime(const Reminder &reminder);
+	static qint64 slack();
+
+	void schedule(const Reminder &reminder, qint64 due);
+	bool cancel(const QUuid &id);
+	void arm();
 };
 
 #endif // WIDGETSSCHEDULER_H
@@ -30,6 +30,11 @@ void TraySnoozeDialog::performComplete()
 		_viewModel->performComplete(_reminders.value(remWidget));
 }
 
+void TraySnoozeDialog::performCompleteAll()
+{
+	_viewModel->performCompleteAll();
+}
+
 void TraySnoozeDialog::performSnooze()
 {
 	auto remWidget = _toolBox->currentWidget();
@@ -59,6 +64,7 @@ void TraySnoozeDialog::reloadReminders(const QList<Reminder> &reminders)
 	_reminders.clear();
 	for(const auto &rem : reminders)
 		addReminder(rem);
+	_completeAllButton->setVisible(reminders.size() > 1);
 	resizeUi();
 }
 
@@ -74,8 +80,15 @@ void TraySnoozeDialog::setupUi()
 	_toolBox = new QToolBox(this);
 	_toolBox->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Fixed);
 
+	_completeAllButton = new QPushButton{tr("Complete &all"), this};
+	_completeAllButton->setAutoDefault(false);
+	_completeAllButton->setDefault(false);
+	connect(_completeAllButton, &QPushButton::clicked,
+			this, &TraySnoozeDialog::performCompleteAll);
+
 	layout->addWidget(label);
 	layout->addWidget(_toolBox);
+	layout->addWidget(_completeAllButton, 0, Qt::AlignRight);
 
 	adjustSize();
 	DialogMaster::masterDialog(this, true);
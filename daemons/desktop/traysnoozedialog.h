@@ -2,6 +2,7 @@
 #define WIDGETSSNOOZEDIALOG_H
 
 #include <QDialog>
+#include <QPushButton>
 #include <QToolBox>
 #include "traysnoozeviewmodel.h"
 
@@ -17,6 +18,7 @@ public slots:
 
 private slots:
 	void performComplete();
+	void performCompleteAll();
 	void performSnooze();
 	void performUrlOpen();
 
@@ -25,6 +27,7 @@ private slots:
 private:
 	TraySnoozeViewModel *_viewModel;
 	QToolBox *_toolBox = nullptr;
+	QPushButton *_completeAllButton = nullptr;
 	QHash<QWidget*, QUuid> _reminders;
 
 	void setupUi();
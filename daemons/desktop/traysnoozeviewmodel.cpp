@@ -42,6 +42,17 @@ void TraySnoozeViewModel::performComplete(QUuid id)
 	emit remindersChanged(_reminders.values());
 }
 
+void TraySnoozeViewModel::performCompleteAll()
+{
+	if(_reminders.isEmpty())
+		return;
+
+	auto reminders = _reminders.values();
+	_reminders.clear();
+	emit _notifier->messagesCompleted(reminders);
+	emit remindersChanged(_reminders.values());
+}
+
 void TraySnoozeViewModel::performSnooze(QUuid id, const QString &expression)
 {
 	auto rem = _reminders.value(id);
@@ -30,6 +30,7 @@ public:
 
 public slots:
 	void performComplete(QUuid id);
+	void performCompleteAll();
 	void performSnooze(QUuid id, const QString &expression);
 	void openUrls(QUuid id);
 
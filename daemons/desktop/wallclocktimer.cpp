@@ -0,0 +1,116 @@
+#include "wallclocktimer.h"
+#include <QDateTime>
+#include <QLoggingCategory>
+#include <QSocketNotifier>
+#include <chrono>
+#include <limits>
+#ifdef Q_OS_LINUX
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+#endif
+using namespace std::chrono;
+
+Q_DECLARE_LOGGING_CATEGORY(scheduler)
+
+WallClockTimer::WallClockTimer(QObject *parent) :
+	QObject(parent),
+	_fallbackTimer(new QTimer(this))
+{
+	_fallbackTimer->setSingleShot(true);
+	_fallbackTimer->setTimerType(Qt::VeryCoarseTimer);
+	connect(_fallbackTimer, &QTimer::timeout,
+			this, &WallClockTimer::timeout);
+
+#ifdef Q_OS_LINUX
+	_timerFd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+	if(_timerFd == -1)
+		qCWarning(scheduler) << "Failed to create timerfd, falling back to relative timers:" << strerror(errno);
+	else {
+		_notifier = new QSocketNotifier(_timerFd, QSocketNotifier::Read, this);
+		connect(_notifier, &QSocketNotifier::activated,
+				this, &WallClockTimer::timerFdActivated);
+	}
+#endif
+}
+
+WallClockTimer::~WallClockTimer()
+{
+#ifdef Q_OS_LINUX
+	if(_timerFd != -1) {
+		delete _notifier;
+		::close(_timerFd);
+	}
+#endif
+}
+
+bool WallClockTimer::detectsClockChanges() const
+{
+	return _timerFd != -1;
+}
+
+void WallClockTimer::start(qint64 msecsSinceEpoch)
+{
+	if(startTimerFd(msecsSinceEpoch))
+		_fallbackTimer->stop();
+	else
+		startFallback(msecsSinceEpoch);
+}
+
+void WallClockTimer::stop()
+{
+	_fallbackTimer->stop();
+#ifdef Q_OS_LINUX
+	if(_timerFd != -1) {
+		const itimerspec disarm {};
+		timerfd_settime(_timerFd, 0, &disarm, nullptr);
+	}
+#endif
+}
+
+void WallClockTimer::timerFdActivated()
+{
+#ifdef Q_OS_LINUX
+	quint64 expirations = 0;
+	if(::read(_timerFd, &expirations, sizeof(expirations)) == -1) {
+		if(errno == ECANCELED) {
+			qCInfo(scheduler) << "System clock was changed";
+			emit clockChanged();
+		} else if(errno != EAGAIN)
+			qCWarning(scheduler) << "Failed to read from timerfd:" << strerror(errno);
+	} else
+		emit timeout();
+#endif
+}
+
+bool WallClockTimer::startTimerFd(qint64 msecsSinceEpoch)
+{
+#ifdef Q_OS_LINUX
+	if(_timerFd == -1)
+		return false;
+
+	// a zero value would disarm the timer instead
+	const auto msecs = std::max<qint64>(msecsSinceEpoch, 1);
+	itimerspec spec {};
+	spec.it_value.tv_sec = static_cast<time_t>(msecs / 1000);
+	spec.it_value.tv_nsec = static_cast<long>(duration_cast<nanoseconds>(milliseconds{msecs % 1000}).count());
+	if(timerfd_settime(_timerFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) == 0)
+		return true;
+
+	qCWarning(scheduler) << "Failed to arm timerfd, falling back to a relative timer:" << strerror(errno);
+	return false;
+#else
+	Q_UNUSED(msecsSinceEpoch)
+	return false;
+#endif
+}
+
+void WallClockTimer::startFallback(qint64 msecsSinceEpoch)
+{
+	const auto interval = msecsSinceEpoch - QDateTime::currentMSecsSinceEpoch();
+	_fallbackTimer->start(static_cast<int>(qBound<qint64>(0, interval, std::numeric_limits<int>::max())));
+}
@@ -0,0 +1,42 @@
+#ifndef WALLCLOCKTIMER_H
+#define WALLCLOCKTIMER_H
+
+#include <QObject>
+#include <QTimer>
+
+class QSocketNotifier;
+
+// single shot timer for an absolute utc time. On linux, it is based on the real time clock, so it
+// keeps it's target over suspends and reports changes of the system clock
+class WallClockTimer : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit WallClockTimer(QObject *parent = nullptr);
+	~WallClockTimer() override;
+
+	bool detectsClockChanges() const;
+
+public slots:
+	void start(qint64 msecsSinceEpoch);
+	void stop();
+
+signals:
+	void timeout();
+	// the timer was stopped because the system clock was set
+	void clockChanged();
+
+private slots:
+	void timerFdActivated();
+
+private:
+	QTimer *_fallbackTimer;
+	int _timerFd = -1;
+	QSocketNotifier *_notifier = nullptr;
+
+	bool startTimerFd(qint64 msecsSinceEpoch);
+	void startFallback(qint64 msecsSinceEpoch);
+};
+
+#endif // WALLCLOCKTIMER_H
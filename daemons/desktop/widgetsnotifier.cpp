@@ -35,6 +35,23 @@ void WidgetsNotifier::showNotification(const Reminder &reminder)
 	qCDebug(notifier) << "Showed notification for reminder with id" << reminder.id();
 }
 
+void WidgetsNotifier::showNotifications(const QList<Reminder> &reminders)
+{
+	QStringList lines;
+	lines.reserve(reminders.size());
+	for(const auto &reminder : reminders) {
+		_notifications.insert(reminder.id(), reminder);
+		lines.append(tr("• %1").arg(reminder.description()));
+	}
+	updateIcon();
+
+	_trayIco->showMessage(tr("%1 — %n Reminder(s)", "", reminders.size())
+						  .arg(QApplication::applicationDisplayName()),
+						  lines.join(QLatin1Char('\n')),
+						  QSystemTrayIcon::Information);
+	qCDebug(notifier) << "Showed grouped notification for" << reminders.size() << "reminders";
+}
+
 void WidgetsNotifier::removeNotification(QUuid id)
 {
 	if(_notifications.remove(id) > 0) {
@@ -23,12 +23,14 @@ public:
 
 public slots:
 	void showNotification(const Reminder &reminder) override;
+	void showNotifications(const QList<Reminder> &reminders) override;
 	void removeNotification(QUuid id) override;
 	void showErrorMessage(const QString &error) override;
 	void cancelAll() override;
 
 signals:
 	void messageCompleted(QUuid id, quint32 versionCode) final;
+	void messagesCompleted(const QList<Reminder> &reminders) final;
 	void messageDelayed(QUuid id, quint32 versionCode, const QDateTime &nextTrigger) final;
 	void messageActivated(QUuid id = {}) final;
 	void messageOpenUrls(QUuid id) final;
@@ -15,13 +15,15 @@ public class Scheduler {
 		_context = context;
 	}
 
-	public void createSchedule(String remId, int versionCode, boolean important, long triggerAt) {
+	public void createSchedule(String remId, int versionCode, boolean important, long triggerAt, long window) {
 		PendingIntent pending = Globals.createPending(_context, Globals.Actions.ActionScheduler, remId, versionCode);
 		AlarmManager manager = (AlarmManager) _context.getSystemService(Context.ALARM_SERVICE);
 		if(important)
 			AlarmManagerCompat.setExactAndAllowWhileIdle(manager, AlarmManager.RTC_WAKEUP, triggerAt, pending);
+		else if(window > 0)
+			manager.setWindow(AlarmManager.RTC_WAKEUP, triggerAt, window, pending);
 		else
-			manager.setWindow(AlarmManager.RTC_WAKEUP, triggerAt, 5 * 60 * 1000, pending);//max 5 min window
+			AlarmManagerCompat.setExact(manager, AlarmManager.RTC_WAKEUP, triggerAt, pending);
 	}
 
 	public void cancelSchedule(String remId) {
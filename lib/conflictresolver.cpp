@@ -1,4 +1,20 @@
 #include "conflictresolver.h"
+#include "timezoneservice.h"
+#include <limits>
+
+namespace {
+
+const qint64 InvalidTime = std::numeric_limits<qint64>::min();
+
+qint64 toMSecs(const QDateTime &dateTime)
+{
+	if(dateTime.isValid())
+		return TimeZoneService::instance()->toMSecsSinceEpoch(dateTime);
+	else
+		return InvalidTime;
+}
+
+}
 
 ConflictResolver::ConflictResolver(QObject *parent) :
 	GenericConflictResolver<Reminder>(parent)
@@ -7,30 +23,66 @@ ConflictResolver::ConflictResolver(QObject *parent) :
 Reminder ConflictResolver::resolveConflict(Reminder data1, Reminder data2, QObject *parent) const
 {
 	Q_UNUSED(parent)
+	const auto resolution = resolve(data1, data2);
+	if(resolution == FirstWins)
+		return data1;
+	else if(resolution == SecondWins)
+		return data2;
+	else
+		throw NoConflictResultException{};
+}
+
+ConflictResolver::Resolution ConflictResolver::resolve(const Reminder &data1, const Reminder &data2)
+{
 	Q_ASSERT_X(data1.id() == data2.id(), Q_FUNC_INFO, "Reminders with different IDs cannot be merged");
 
+	const auto resolution = resolve(Metadata::of(data1), Metadata::of(data2));
+	if(resolution != NoResolution)
+		return resolution;
+
+	//compare the schedules, as sub schedules can differ with the same due time
+	const auto latest1 = data1.latestScheduleTime();
+	const auto latest2 = data2.latestScheduleTime();
+	if(latest1 > latest2)
+		return FirstWins;
+	else if(latest2 > latest1)
+		return SecondWins;
+	return NoResolution;
+}
+
+ConflictResolver::Resolution ConflictResolver::resolve(const Metadata &meta1, const Metadata &meta2)
+{
 	//compare version code
-	if(data1.versionCode() > data2.versionCode())
-		return data1;
-	else if(data2.versionCode() > data1.versionCode())
-		return data2;
+	if(meta1.versionCode > meta2.versionCode)
+		return FirstWins;
+	else if(meta2.versionCode > meta1.versionCode)
+		return SecondWins;
 
 	//compare snooze times
-	if(data1.snooze().isValid()) {
-		if(!data2.snooze().isValid())
-			return data1;
-		else if(data1.snooze() > data2.snooze()) //shorter snooze wins
-			return data2;
-		else if(data2.snooze() > data1.snooze()) //shorter snooze wins
-			return data1;
-	} else if(data2.snooze().isValid())
-		return data2;
+	if(meta1.snooze != InvalidTime) {
+		if(meta2.snooze == InvalidTime)
+			return FirstWins;
+		else if(meta1.snooze > meta2.snooze) //shorter snooze wins
+			return SecondWins;
+		else if(meta2.snooze > meta1.snooze) //shorter snooze wins
+			return FirstWins;
+	} else if(meta2.snooze != InvalidTime)
+		return SecondWins;
 
 	//compare schedule
-	if(data1.schedule()->current() > data2.schedule()->current())
-		return data1;
-	else if(data2.schedule()->current() > data1.schedule()->current())
-		return data2;
+	if(meta1.due > meta2.due)
+		return FirstWins;
+	else if(meta2.due > meta1.due)
+		return SecondWins;
 	else
-		throw NoConflictResultException{};
+		return NoResolution;
+}
+
+ConflictResolver::Metadata ConflictResolver::Metadata::of(const Reminder &reminder)
+{
+	return {
+		reminder.versionCode(),
+		toMSecs(reminder.snooze()),
+		toMSecs(reminder.due())
+	};
 }
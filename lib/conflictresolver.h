@@ -4,16 +4,38 @@
 #include <QObject>
 #include <QtDataSync/ConflictResolver>
 
+#include "libsyrem_global.h"
 #include "reminder.h"
 
-class ConflictResolver : public QtDataSync::GenericConflictResolver<Reminder>
+class LIB_SYREM_EXPORT ConflictResolver : public QtDataSync::GenericConflictResolver<Reminder>
 {
 	Q_OBJECT
 
 public:
+	enum Resolution {
+		NoResolution,
+		FirstWins,
+		SecondWins
+	};
+
+	// the scalar fields deciding most conflicts. Times are msecs since epoch, invalid ones the minimum
+	struct Metadata {
+		quint32 versionCode;
+		qint64 snooze;
+		qint64 due;
+
+		static Metadata of(const Reminder &reminder);
+	};
+
 	explicit ConflictResolver(QObject *parent = nullptr);
 
 	Reminder resolveConflict(Reminder data1, Reminder data2, QObject *parent) const override;
+
+	// compares the metadata first and only looks at the schedules if that is a tie
+	static Resolution resolve(const Reminder &data1, const Reminder &data2);
+	static Resolution resolve(const Metadata &meta1, const Metadata &meta2);
 };
 
+Q_DECLARE_TYPEINFO(ConflictResolver::Metadata, Q_PRIMITIVE_TYPE);
+
 #endif // CONFLICTRESOLVER_H
@@ -8,6 +8,13 @@
 #include <QVector>
 using namespace Expressions;
 
+struct Term::LoopSplit {
+	Term loop;
+	Term fence;
+	Term from;
+	Term until;
+};
+
 EventExpressionParser::EventExpressionParser(QObject *parent) :
 	QObject{parent}
 {}
@@ -324,6 +331,7 @@ void EventExpressionParser::validateFullTerm(Term &term, Term &rootTerm, int dep
 		limiter = limiter->clone(std::move(term));
 		Q_ASSERT(limiter);
 		rootTerm.last() = limiter;
+		rootTerm.finalize(); // update the cached split with the new limiter
 		swap(term, rootTerm); //move the root to the actual term
 	}
 }
@@ -397,6 +405,7 @@ void EventExpressionParser::parseSubTermImpl<LimiterTerm>(QUuid id, const QStrin
 		if(!term.isEmpty()) {
 			validateFullTerm(term, rootTerm, depth);
 			term.append(result.first);
+			term.finalize();
 			validatePartialTerm(term, depth);
 			parseTerm(id, expression.mid(result.second), {}, termIndex, term, depth);
 		}
@@ -551,6 +560,16 @@ void SubTerm::fixupCleanup(QDateTime &datetime) const
 	Q_UNUSED(datetime)
 }
 
+void SubTerm::compileFixup(TermProgram &program) const
+{
+	Q_UNUSED(program)
+}
+
+void SubTerm::compileFixupCleanup(TermProgram &program) const
+{
+	Q_UNUSED(program)
+}
+
 SubTerm::Type SubTerm::getType() const
 {
 	return type;
@@ -606,59 +625,20 @@ bool Term::hasTimeScope() const
 
 QDateTime Term::apply(const QDateTime &datetime, bool applyFenced) const
 {
-	auto appointment = datetime;
-	for(const auto &term : *this) {
-		if(term->type.testFlag(SubTerm::FlagLimiter)) // skip limiters when applying
-			continue;
-		term->apply(appointment, applyFenced);
-		if(term->type.testFlag(SubTerm::Timepoint))
-			applyFenced = true;
-	}
-
-	if(appointment <= datetime && !isEmpty()) {
-		first()->fixup(appointment); //fix by applying an offset specific to the first subterm. might do nothing
-		for(const auto &term : *this) {
-			if(term->type.testFlag(SubTerm::FlagNeedsFixupCleanup))
-				term->fixupCleanup(appointment);
-		}
-	}
-
-	return appointment;
+	if(_program)
+		return _program->run(datetime, applyFenced);
+	else
+		return TermProgram{*this}.run(datetime, applyFenced);
 }
 
 std::tuple<Term, Term, Term, Term> Term::splitLoop() const
 {
 	if(!isLooped())
 		return {};
-
-	auto splitIndex = -1;
-	auto fromIndex = -1;
-	auto toIndex = -1;
-	for(auto i = 0; i < size(); ++i) {
-		if(at(i)->type.testFlag(SubTerm::FlagLooped))
-			splitIndex = i;
-		else if(at(i)->type == SubTerm::FromSubterm)
-			fromIndex = i;
-		else if(at(i)->type == SubTerm::UntilSubTerm)
-			toIndex = i;
-	}
-
-	// get the firs limiter index (both must be at the end of the sorted sub terms, because they are noscope
-	int endIndex = -1;
-	if(fromIndex != -1) {
-		if(toIndex != -1)
-			endIndex = std::min(fromIndex, toIndex);
-		else
-			endIndex = fromIndex;
-	} else
-		endIndex = toIndex;
-
-	return std::make_tuple(
-		splitIndex != -1 ? Term{mid(splitIndex, endIndex == -1 ? -1 : endIndex - splitIndex)} : Term{mid(0, endIndex)},
-		splitIndex != -1 ? Term{mid(0, splitIndex)} : Term{},
-		fromIndex != -1 ? at(fromIndex).staticCast<LimiterTerm>()->limitTerm() : Term{},
-		toIndex != -1 ? at(toIndex).staticCast<LimiterTerm>()->limitTerm() : Term{}
-						);
+	else if(_split)
+		return std::make_tuple(_split->loop, _split->fence, _split->from, _split->until);
+	else
+		return std::make_tuple(*this, Term{}, Term{}, Term{});
 }
 
 QString Term::describe() const
@@ -689,6 +669,44 @@ void Term::finalize()
 		_looped = _looped || subTerm->type.testFlag(SubTerm::FlagLooped);
 		_absolute = _absolute || subTerm->type.testFlag(SubTerm::FlagAbsolute);
 	}
+	_program = QSharedPointer<const TermProgram>::create(*this);
+	_split = _looped ? createSplit() : QSharedPointer<const LoopSplit>{};
+}
+
+QSharedPointer<const Term::LoopSplit> Term::createSplit() const
+{
+	auto splitIndex = -1;
+	auto fromIndex = -1;
+	auto toIndex = -1;
+	for(auto i = 0; i < size(); ++i) {
+		if(at(i)->type.testFlag(SubTerm::FlagLooped))
+			splitIndex = i;
+		else if(at(i)->type == SubTerm::FromSubterm)
+			fromIndex = i;
+		else if(at(i)->type == SubTerm::UntilSubTerm)
+			toIndex = i;
+	}
+
+	// get the firs limiter index (both must be at the end of the sorted sub terms, because they are noscope
+	int endIndex = -1;
+	if(fromIndex != -1) {
+		if(toIndex != -1)
+			endIndex = std::min(fromIndex, toIndex);
+		else
+			endIndex = fromIndex;
+	} else
+		endIndex = toIndex;
+
+	// a plain loop is its own loop term. Not storing it prevents recursion, as the loop part is finalized as well
+	if(splitIndex == 0 && endIndex == -1)
+		return {};
+
+	return QSharedPointer<const LoopSplit>{new LoopSplit {
+		splitIndex != -1 ? Term{mid(splitIndex, endIndex == -1 ? -1 : endIndex - splitIndex)} : Term{mid(0, endIndex)},
+		splitIndex != -1 ? Term{mid(0, splitIndex)} : Term{},
+		fromIndex != -1 ? at(fromIndex).staticCast<LimiterTerm>()->limitTerm() : Term{},
+		toIndex != -1 ? at(toIndex).staticCast<LimiterTerm>()->limitTerm() : Term{}
+	}};
 }
 
 QString Term::describeImpl() const
@@ -16,6 +16,8 @@ class TermConverter;
 
 namespace Expressions {
 
+class TermProgram;
+
 class LIB_SYREM_EXPORT SubTerm : public QObject
 {
 	Q_OBJECT
@@ -70,6 +72,9 @@ public:
 	virtual void apply(QDateTime &datetime, bool applyFenced) const = 0;
 	virtual void fixup(QDateTime &datetime) const;
 	virtual void fixupCleanup(QDateTime &datetime) const;
+	virtual void compile(TermProgram &program) const = 0;
+	virtual void compileFixup(TermProgram &program) const;
+	virtual void compileFixupCleanup(TermProgram &program) const;
 	virtual QString describe() const = 0;
 
 protected:
@@ -97,6 +102,8 @@ public:
 		std::swap(lhs._scope, rhs._scope);
 		std::swap(lhs._looped, rhs._looped);
 		std::swap(lhs._absolute, rhs._absolute);
+		lhs._program.swap(rhs._program);
+		lhs._split.swap(rhs._split);
 	}
 
 	Term(std::initializer_list<QSharedPointer<SubTerm>> args);
@@ -116,12 +123,17 @@ private:
 	friend class ::EventExpressionParser;
 	friend class ::TermConverter;
 
+	struct LoopSplit;
+
 	void finalize();
+	QSharedPointer<const LoopSplit> createSplit() const;
 	QString describeImpl() const;
 
 	SubTerm::Scope _scope = SubTerm::InvalidScope;
 	bool _looped = false;
 	bool _absolute = false;
+	QSharedPointer<const TermProgram> _program; // compiled by finalize, must be recreated after modifications
+	QSharedPointer<const LoopSplit> _split; // created by finalize, null for non-loops or if the term is its own loop
 };
 
 using TermSelection = QList<Term>;
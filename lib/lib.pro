@@ -18,7 +18,12 @@ HEADERS += \
 	snoozetimes.h \
 	eventexpressionparser.h \
 	terms.h \
-	termconverter.h
+	termprogram.h \
+	timezoneservice.h \
+	termconverter.h \
+	reminderindex.h \
+	reminderbatch.h \
+	reminderwritebuffer.h
 
 SOURCES += \
 	libsyrem.cpp \
@@ -29,7 +34,12 @@ SOURCES += \
 	snoozetimes.cpp \
 	eventexpressionparser.cpp \
 	terms.cpp \
-	termconverter.cpp
+	termprogram.cpp \
+	timezoneservice.cpp \
+	termconverter.cpp \
+	reminderindex.cpp \
+	reminderbatch.cpp \
+	reminderwritebuffer.cpp
 
 SETTINGS_DEFINITIONS += \
 	localsettings.xml \
@@ -6,6 +6,7 @@
 #include <QLibraryInfo>
 #include <QStandardPaths>
 #include <QQueue>
+#include <QThreadStorage>
 
 #include "schedule.h"
 #include "dateparser.h"
@@ -74,6 +75,18 @@ void Syrem::setup(QtDataSync::Setup &setup)
 			.serializer()->addJsonTypeConverter<TermConverter>();
 }
 
+QJsonSerializer *Syrem::serializer()
+{
+	// not shared between threads, as converters are not guaranteed to be reentrant
+	static QThreadStorage<QJsonSerializer*> serializers;
+	if(!serializers.hasLocalData()) {
+		auto serializer = new QJsonSerializer{};
+		serializer->addJsonTypeConverter<TermConverter>();
+		serializers.setLocalData(serializer);
+	}
+	return serializers.localData();
+}
+
 QString Syrem::whenExpressionHelp()
 {
 	QStringList singularTable;
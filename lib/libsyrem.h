@@ -7,6 +7,8 @@
 #include "libsyrem_global.h"
 #include "reminder.h"
 
+class QJsonSerializer;
+
 using ReminderStore = QtDataSync::DataTypeStore<Reminder, QUuid>;
 
 namespace Syrem {
@@ -14,6 +16,8 @@ namespace Syrem {
 LIB_SYREM_EXPORT void prepareTranslations(const QString &tsName);
 LIB_SYREM_EXPORT void setup(QtDataSync::Setup &setup);
 LIB_SYREM_EXPORT QString whenExpressionHelp();
+// configured like the one of the datasync setup, one instance per thread
+LIB_SYREM_EXPORT QJsonSerializer *serializer();
 
 }
 
@@ -2,6 +2,13 @@
 
 #include <QRegularExpression>
 #include <QDesktopServices>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonSerializer>
+#include <QJsonSerializerException>
+#include <QMutex>
+#include "libsyrem.h"
+#include "reminderwritebuffer.h"
 
 using namespace QtDataSync;
 
@@ -9,17 +16,45 @@ class ReminderData : public QSharedData
 {
 public:
 	ReminderData() = default;
-	ReminderData(const ReminderData &other) = default;
+	ReminderData(const ReminderData &other);
 
 	QUuid id = QUuid::createUuid();
 	quint32 versionCode = 1;
 	QString text;
 	bool important = false;
-	QSharedPointer<Schedule> schedule;
+	bool hasSchedule = false;
+	QDateTime due;
+	int repeating = -1; // unknown until the schedule was loaded, if not stored
 	QDateTime snooze;
 	QString expression;
+
+	// loaded from the raw data on first use, which may happen from multiple threads on shared data
+	mutable QMutex scheduleLock;
+	mutable QJsonObject rawSchedule;
+	mutable QSharedPointer<const Schedule> schedule; // immutable, shared between copies
+	mutable ScheduleCursor cursor;
+	mutable QByteArray scheduleError; // set if the raw data could not be loaded, which is then kept as is
 };
 
+ReminderData::ReminderData(const ReminderData &other) :
+	QSharedData{other},
+	id{other.id},
+	versionCode{other.versionCode},
+	text{other.text},
+	important{other.important},
+	hasSchedule{other.hasSchedule},
+	due{other.due},
+	repeating{other.repeating},
+	snooze{other.snooze},
+	expression{other.expression}
+{
+	QMutexLocker locker{&other.scheduleLock};
+	rawSchedule = other.rawSchedule;
+	schedule = other.schedule;
+	cursor = other.cursor;
+	scheduleError = other.scheduleError;
+}
+
 Reminder::Reminder() :
 	_data(new ReminderData)
 {}
@@ -56,18 +91,26 @@ bool Reminder::isImportant() const
 
 QDateTime Reminder::current() const
 {
-	if(_data->schedule) {
+	if(_data->hasSchedule) {
 		if(_data->snooze.isValid())
 			return _data->snooze;
 		else
-			return _data->schedule->current();
+			return _data->due;
 	} else
 		return {};
 }
 
+QDateTime Reminder::due() const
+{
+	return _data->due;
+}
+
 bool Reminder::isRepeating() const
 {
-	if(_data->schedule)
+	if(_data->repeating != -1)
+		return _data->repeating != 0;
+
+	if(tryLoadSchedule() && _data->schedule)
 		return _data->schedule->isRepeating();
 	else
 		return false;
@@ -87,7 +130,23 @@ Reminder::State Reminder::triggerState() const
 
 QSharedPointer<const Schedule> Reminder::schedule() const
 {
-	return _data->schedule.constCast<const Schedule>();
+	loadSchedule();
+	return _data->schedule;
+}
+
+ScheduleCursor Reminder::scheduleCursor() const
+{
+	loadSchedule();
+	return _data->cursor;
+}
+
+QVector<QDateTime> Reminder::occurrences(const QDateTime &from, const QDateTime &to, int limit) const
+{
+	loadSchedule();
+	if(_data->schedule)
+		return _data->schedule->occurrences(_data->cursor, from, to, limit);
+	else
+		return {};
 }
 
 QDateTime Reminder::snooze() const
@@ -132,28 +191,53 @@ bool Reminder::hasUrls() const
 
 void Reminder::nextSchedule(DataStore *store, const QDateTime &current)
 {
+	if(advanceSchedule(current))
+		store->save(*this);
+	else
+		store->remove<Reminder>(_data->id);
+}
+
+void Reminder::performSnooze(DataStore *store, const QDateTime &snooze)
+{
+	applySnooze(snooze);
+	store->save(*this);
+}
+
+void Reminder::nextSchedule(ReminderWriteBuffer *buffer, const QDateTime &current)
+{
+	if(advanceSchedule(current))
+		buffer->save(*this);
+	else
+		buffer->remove(_data->id);
+}
+
+void Reminder::performSnooze(ReminderWriteBuffer *buffer, const QDateTime &snooze)
+{
+	applySnooze(snooze);
+	buffer->save(*this);
+}
+
+bool Reminder::advanceSchedule(const QDateTime &current)
+{
+	loadSchedule();
 	Q_ASSERT_X(_data->schedule, Q_FUNC_INFO, "cannot call next schedule without an assigned schedule");
+	if(!_data->schedule)
+		return false;
 
-	QDateTime res;
-	do {
-		res = _data->schedule->nextSchedule();
-	} while(res.isValid() && res <= current);
+	const auto res = _data->schedule->nextAfter(_data->cursor, current);
 
+	_data->due = res;
 	_data->snooze = QDateTime();//reset any snoozes
 	_data->versionCode++;
-	if(res.isValid())
-		store->save(*this);
-	else
-		store->remove<Reminder>(_data->id);
+	return res.isValid();
 }
 
-void Reminder::performSnooze(DataStore *store, const QDateTime &snooze)
+void Reminder::applySnooze(const QDateTime &snooze)
 {
-	if(_data->schedule && snooze <= _data->schedule->current())
+	if(_data->hasSchedule && snooze <= _data->due)
 		throw EventExpressionParserException{EventExpressionParser::tr("The snooze time must be in the future of the normal reminder time and not in the past of it.")};
 	_data->snooze = snooze;
 	_data->versionCode++;
-	store->save(*this);
 }
 
 void Reminder::openUrls() const
@@ -181,6 +265,12 @@ void Reminder::setImportant(bool important)
 
 void Reminder::setSchedule(QSharedPointer<Schedule> schedule)
 {
+	_data->rawSchedule = {};
+	_data->scheduleError.clear();
+	_data->hasSchedule = !schedule.isNull();
+	_data->cursor = schedule ? schedule->cursor() : ScheduleCursor{};
+	_data->due = _data->cursor.current;
+	_data->repeating = schedule ? schedule->isRepeating() : -1;
 	_data->schedule = std::move(schedule);
 }
 
@@ -196,7 +286,8 @@ bool Reminder::operator==(const Reminder &other) const
 		_data->versionCode == other._data->versionCode &&
 		_data->text == other._data->text &&
 		_data->important == other._data->important &&
-		_data->schedule == other._data->schedule &&
+		_data->due == other._data->due &&
+		equalSchedules(other) &&
 		_data->snooze == other._data->snooze &&
 		_data->expression == other._data->expression);
 }
@@ -206,9 +297,55 @@ void Reminder::setVersionCode(quint32 versionCode)
 	_data->versionCode = versionCode;
 }
 
+void Reminder::setDue(QDateTime due)
+{
+	_data->due = std::move(due);
+}
+
+void Reminder::setRepeating(bool repeating)
+{
+	_data->repeating = repeating ? 1 : 0;
+}
+
 QSharedPointer<Schedule> Reminder::getSchedule() const
 {
-	return _data->schedule;
+	// combine definition and state again for serialization
+	loadSchedule();
+	if(!_data->schedule)
+		return {};
+	auto schedule = _data->schedule->clone();
+	schedule->setCursor(_data->cursor);
+	return schedule;
+}
+
+QJsonObject Reminder::getScheduleData() const
+{
+	{
+		QMutexLocker locker{&_data->scheduleLock};
+		if(!_data->rawSchedule.isEmpty()) // unchanged since it was loaded
+			return _data->rawSchedule;
+	}
+
+	const auto schedule = getSchedule();
+	if(schedule)
+		return Syrem::serializer()->serialize(QVariant::fromValue(schedule)).toObject();
+	else
+		return {};
+}
+
+void Reminder::setScheduleData(QJsonObject data)
+{
+	_data->schedule.reset();
+	_data->cursor = {};
+	_data->scheduleError.clear();
+	_data->hasSchedule = !data.isEmpty();
+	// data stored before the due time was a field of it's own only has it in the schedule
+	if(!_data->due.isValid() && _data->hasSchedule) {
+		_data->due = Syrem::serializer()->deserialize(data.value(QStringLiteral("current")),
+													 QMetaType::QDateTime)
+					 .toDateTime();
+	}
+	_data->rawSchedule = std::move(data);
 }
 
 void Reminder::setSnooze(QDateTime snooze)
@@ -216,6 +353,81 @@ void Reminder::setSnooze(QDateTime snooze)
 	_data->snooze = std::move(snooze);
 }
 
+void Reminder::loadSchedule() const
+{
+	if(!tryLoadSchedule())
+		throw QJsonDeserializationException{_data->scheduleError};
+}
+
+bool Reminder::tryLoadSchedule() const
+{
+	QMutexLocker locker{&_data->scheduleLock};
+	if(!_data->scheduleError.isNull())
+		return false;
+	if(_data->rawSchedule.isEmpty())
+		return true;
+
+	try {
+		auto schedule = Syrem::serializer()->deserialize(_data->rawSchedule,
+														qMetaTypeId<QSharedPointer<Schedule>>())
+						.value<QSharedPointer<Schedule>>();
+		_data->cursor = schedule ? schedule->cursor() : ScheduleCursor{};
+		_data->schedule = std::move(schedule);
+		_data->rawSchedule = {};
+		return true;
+	} catch(QJsonSerializerException &e) {
+		qWarning() << "Failed to load schedule of reminder" << _data->id
+				   << "with error:" << e.what();
+		// the raw data stays, so saving the reminder does not lose it
+		_data->scheduleError = QByteArray{"Failed to load schedule of reminder "} +
+							   _data->id.toByteArray() + ": " + e.what();
+		return false;
+	}
+}
+
+static QDateTime latestCurrent(const ScheduleCursor &cursor)
+{
+	auto latest = cursor.current;
+	for(const auto &subCursor : cursor.subCursors) {
+		const auto subLatest = latestCurrent(subCursor);
+		if(!latest.isValid() || subLatest > latest)
+			latest = subLatest;
+	}
+	return latest;
+}
+
+static QDateTime latestCurrent(const QJsonObject &schedule)
+{
+	auto latest = Syrem::serializer()->deserialize(schedule.value(QStringLiteral("current")), QMetaType::QDateTime).toDateTime();
+	for(const auto &subSchedule : schedule.value(QStringLiteral("subSchedules")).toArray()) {
+		const auto subLatest = latestCurrent(subSchedule.toObject());
+		if(!latest.isValid() || subLatest > latest)
+			latest = subLatest;
+	}
+	return latest;
+}
+
+bool Reminder::equalSchedules(const Reminder &other) const
+{
+	const auto loaded = tryLoadSchedule();
+	if(loaded != other.tryLoadSchedule())
+		return false;
+	else if(loaded) {
+		return _data->cursor == other._data->cursor &&
+				_data->schedule == other._data->schedule;
+	} else
+		return _data->rawSchedule == other._data->rawSchedule;
+}
+
+QDateTime Reminder::latestScheduleTime() const
+{
+	QMutexLocker locker{&_data->scheduleLock};
+	if(!_data->rawSchedule.isEmpty())
+		return latestCurrent(_data->rawSchedule);
+	else
+		return latestCurrent(_data->cursor);
+}
+
 
 
 uint qHash(const Reminder &reminder, uint seed)
@@ -224,7 +436,7 @@ uint qHash(const Reminder &reminder, uint seed)
 			qHash(reminder._data->versionCode, seed) ^
 			qHash(reminder._data->text, seed) ^
 			qHash(reminder._data->important, seed) ^
-			qHash(reminder._data->schedule, seed) ^
+			qHash(reminder._data->due, seed) ^
 			qHash(reminder._data->snooze, seed) ^
 			qHash(reminder._data->expression, seed);
 }
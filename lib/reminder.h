@@ -8,12 +8,14 @@
 #include <QUrl>
 #include <QUuid>
 #include <QHash>
+#include <QJsonObject>
 #include <QtDataSync/DataTypeStore>
 
 #include "libsyrem_global.h"
 #include "schedule.h"
 
 class ReminderData;
+class ReminderWriteBuffer;
 
 class LIB_SYREM_EXPORT Reminder
 {
@@ -29,9 +31,13 @@ class LIB_SYREM_EXPORT Reminder
 	Q_PROPERTY(bool hasUrls READ hasUrls STORED false)
 
 	Q_PROPERTY(QDateTime current READ current STORED false)
-	Q_PROPERTY(bool repeating READ isRepeating STORED false)
+	// copies of the schedule state, so they can be read without loading the schedule
+	Q_PROPERTY(QDateTime due READ due WRITE setDue)
+	Q_PROPERTY(bool repeating READ isRepeating WRITE setRepeating)
 	Q_PROPERTY(State triggerState READ triggerState STORED false)
-	Q_PROPERTY(QSharedPointer<Schedule> schedule READ getSchedule WRITE setSchedule)
+	// kept serialized until the schedule itself is needed
+	Q_PROPERTY(QJsonObject schedule READ getScheduleData WRITE setScheduleData)
+	Q_PROPERTY(QSharedPointer<Schedule> scheduleObject READ getSchedule WRITE setSchedule STORED false)
 
 	Q_PROPERTY(QDateTime snooze READ snooze WRITE setSnooze)
 
@@ -59,9 +65,17 @@ public:
 	QString description() const;
 	bool isImportant() const;
 	QDateTime current() const;
+	// the current time of the schedule, without snoozes
+	QDateTime due() const;
 	bool isRepeating() const;
 	State triggerState() const;
+	// all throw QJsonDeserializationException if the stored schedule could not be loaded.
+	// The schedule is only the definition, shared between copies. It's own current and cursor are
+	// the state it was created with, so use the ones of the reminder instead
 	QSharedPointer<const Schedule> schedule() const;
+	ScheduleCursor scheduleCursor() const;
+	// all schedules in [from, to), starting at the current state of the reminder, ignoring snoozes
+	QVector<QDateTime> occurrences(const QDateTime &from, const QDateTime &to, int limit = -1) const;
 	QDateTime snooze() const;
 	QString expression() const;
 
@@ -71,6 +85,12 @@ public:
 
 	void nextSchedule(QtDataSync::DataStore *store, const QDateTime &current);
 	void performSnooze(QtDataSync::DataStore *store, const QDateTime &snooze);
+	void nextSchedule(ReminderWriteBuffer *buffer, const QDateTime &current);
+	void performSnooze(ReminderWriteBuffer *buffer, const QDateTime &snooze);
+	// same as the two above, but without writing to a store. Returns false if there is no next time,
+	// meaning the reminder should be deleted instead of saved
+	bool advanceSchedule(const QDateTime &current);
+	void applySnooze(const QDateTime &snooze);
 
 	Q_INVOKABLE void openUrls() const;
 
@@ -84,6 +104,7 @@ public:
 
 private:
 	friend LIB_SYREM_EXPORT uint qHash(const Reminder &reminder, uint seed);
+	friend class ConflictResolver;
 
 	QSharedDataPointer<ReminderData> _data;
 	mutable struct {
@@ -92,8 +113,19 @@ private:
 	} _urlCache;
 
 	void setVersionCode(quint32 versionCode);
+	void setDue(QDateTime due);
+	void setRepeating(bool repeating);
 	QSharedPointer<Schedule> getSchedule() const;
+	QJsonObject getScheduleData() const;
+	void setScheduleData(QJsonObject data);
 	void setSnooze(QDateTime snooze);
+
+	// throws QJsonDeserializationException if the stored schedule is broken
+	void loadSchedule() const;
+	bool tryLoadSchedule() const;
+	bool equalSchedules(const Reminder &other) const;
+	// the latest time any part of the schedule has reached. Reads the stored data if not loaded
+	QDateTime latestScheduleTime() const;
 };
 
 LIB_SYREM_EXPORT uint qHash(const Reminder &reminder, uint seed);
@@ -0,0 +1,79 @@
+#include "reminderbatch.h"
+
+ReminderBatch::ReminderBatch(ReminderStore *store, QObject *parent) :
+	QObject{parent},
+	_store{store}
+{}
+
+ReminderStore *ReminderBatch::store() const
+{
+	return _store;
+}
+
+bool ReminderBatch::wasWritten(const QString &key, const QVariant &value)
+{
+	const auto it = _written.find(QUuid{key});
+	if(it == _written.end())
+		return false;
+
+	// any other change to the reminder means the written one is outdated
+	const auto versionCode = it.value();
+	_written.erase(it);
+	if(value.isValid())
+		return versionCode != 0 && value.value<Reminder>().versionCode() == versionCode;
+	else
+		return versionCode == 0;
+}
+
+void ReminderBatch::complete(QList<Reminder> reminders, const QDateTime &current)
+{
+	QList<Reminder> save;
+	QList<QUuid> remove;
+	save.reserve(reminders.size());
+	for(auto &reminder : reminders) {
+		if(reminder.advanceSchedule(current))
+			save.append(reminder);
+		else
+			remove.append(reminder.id());
+	}
+	write(save, remove);
+}
+
+void ReminderBatch::snooze(QList<Reminder> reminders, const QDateTime &snooze)
+{
+	for(auto &reminder : reminders)
+		reminder.applySnooze(snooze);
+	write(reminders, {});
+}
+
+void ReminderBatch::remove(const QList<QUuid> &ids)
+{
+	write({}, ids);
+}
+
+void ReminderBatch::write(const QList<Reminder> &save, const QList<QUuid> &remove)
+{
+	if(save.isEmpty() && remove.isEmpty())
+		return;
+
+	QList<Reminder> saved;
+	QList<QUuid> removed;
+	saved.reserve(save.size());
+	try {
+		for(const auto &reminder : save) {
+			_store->save(reminder);
+			_written.insert(reminder.id(), reminder.versionCode());
+			saved.append(reminder);
+		}
+		for(const auto &id : remove) {
+			if(_store->remove(id)) {
+				_written.insert(id, 0);
+				removed.append(id);
+			}
+		}
+	} catch(...) {
+		emit written(saved, removed);
+		throw;
+	}
+	emit written(saved, removed);
+}
@@ -0,0 +1,42 @@
+#ifndef REMINDERBATCH_H
+#define REMINDERBATCH_H
+
+#include <QObject>
+#include <QHash>
+
+#include "libsyrem_global.h"
+#include "libsyrem.h"
+
+// applies the same action to many reminders at once. All new states are computed before the first
+// write, so an invalid snooze or a broken schedule leaves the store untouched. Datasync has no
+// transactions spanning multiple keys, but listeners get a single notification per batch
+class LIB_SYREM_EXPORT ReminderBatch : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit ReminderBatch(ReminderStore *store, QObject *parent = nullptr);
+
+	ReminderStore *store() const;
+	// true if the store change was already reported by the written signal, so listeners can skip it.
+	// Matched by the version code, as the store signals may be delivered any time after the write
+	bool wasWritten(const QString &key, const QVariant &value);
+
+	// reminders without a next time are deleted
+	void complete(QList<Reminder> reminders, const QDateTime &current);
+	void snooze(QList<Reminder> reminders, const QDateTime &snooze);
+	void remove(const QList<QUuid> &ids);
+
+signals:
+	// emitted once per batch, even if a write failed after others succeeded
+	void written(const QList<Reminder> &saved, const QList<QUuid> &removed);
+
+private:
+	ReminderStore *_store;
+	// version codes of the written reminders whose store signal is still expected. 0 for removals
+	QHash<QUuid, quint32> _written;
+
+	void write(const QList<Reminder> &save, const QList<QUuid> &remove);
+};
+
+#endif // REMINDERBATCH_H
@@ -0,0 +1,201 @@
+#include "reminderindex.h"
+#include "timezoneservice.h"
+#include <QDebug>
+#include <QSet>
+
+ReminderIndex::ReminderIndex(QObject *parent) :
+	QObject{parent}
+{
+	connect(TimeZoneService::instance(), &TimeZoneService::systemZoneChanged,
+			this, &ReminderIndex::rebuild);
+}
+
+bool ReminderIndex::Changes::isEmpty() const
+{
+	return added.isEmpty() && updated.isEmpty() && removed.isEmpty();
+}
+
+void ReminderIndex::attach(ReminderStore *store)
+{
+	reset(store->loadAll());
+	_store = store;
+	connect(store, &QtDataSync::DataTypeStoreBase::dataChanged,
+			this, &ReminderIndex::dataChanged,
+			Qt::UniqueConnection);
+	connect(store, &QtDataSync::DataTypeStoreBase::dataResetted,
+			this, &ReminderIndex::dataResetted,
+			Qt::UniqueConnection);
+}
+
+int ReminderIndex::size() const
+{
+	return _entries.size();
+}
+
+bool ReminderIndex::contains(const QUuid &id) const
+{
+	return _entries.contains(id);
+}
+
+Reminder ReminderIndex::reminder(const QUuid &id) const
+{
+	const auto it = _entries.constFind(id);
+	Q_ASSERT_X(it != _entries.constEnd(), Q_FUNC_INFO, "cannot get a reminder that is not in the index");
+	return it->reminder;
+}
+
+QList<Reminder> ReminderIndex::reminders() const
+{
+	QList<Reminder> reminders;
+	reminders.reserve(_entries.size());
+	for(const auto &entry : _entries)
+		reminders.append(entry.reminder);
+	return reminders;
+}
+
+bool ReminderIndex::hasDue() const
+{
+	return !_byDue.isEmpty();
+}
+
+Reminder ReminderIndex::nextDue() const
+{
+	Q_ASSERT_X(!_byDue.isEmpty(), Q_FUNC_INFO, "cannot get the next due reminder without any due");
+	return reminder(_byDue.first());
+}
+
+QList<Reminder> ReminderIndex::dueReminders() const
+{
+	return collect(_byDue.constBegin(), _byDue.constEnd());
+}
+
+QList<Reminder> ReminderIndex::dueBefore(const QDateTime &time) const
+{
+	const auto msecs = TimeZoneService::instance()->toMSecsSinceEpoch(time);
+	return collect(_byDue.constBegin(), _byDue.lowerBound(msecs));
+}
+
+QList<Reminder> ReminderIndex::dueBetween(const QDateTime &from, const QDateTime &to) const
+{
+	const auto fromMSecs = TimeZoneService::instance()->toMSecsSinceEpoch(from);
+	const auto toMSecs = TimeZoneService::instance()->toMSecsSinceEpoch(to);
+	if(toMSecs <= fromMSecs)
+		return {};
+	return collect(_byDue.lowerBound(fromMSecs), _byDue.lowerBound(toMSecs));
+}
+
+ReminderIndex::Changes ReminderIndex::reconcile(const QList<Reminder> &reminders)
+{
+	QHash<QUuid, quint32> knownVersions;
+	knownVersions.reserve(_entries.size());
+	for(auto it = _entries.constBegin(); it != _entries.constEnd(); ++it)
+		knownVersions.insert(it.key(), it->reminder.versionCode());
+
+	auto changes = diff(knownVersions, reminders);
+	for(const auto &id : qAsConst(changes.removed))
+		remove(id);
+	for(const auto &reminder : qAsConst(changes.added))
+		addEntry(reminder);
+	for(const auto &reminder : qAsConst(changes.updated))
+		insert(reminder);
+	return changes;
+}
+
+ReminderIndex::Changes ReminderIndex::diff(const QHash<QUuid, quint32> &knownVersions, const QList<Reminder> &reminders)
+{
+	Changes changes;
+	QSet<QUuid> remaining;
+	remaining.reserve(reminders.size());
+	for(const auto &reminder : reminders) {
+		remaining.insert(reminder.id());
+		const auto known = knownVersions.constFind(reminder.id());
+		if(known == knownVersions.constEnd())
+			changes.added.append(reminder);
+		else if(*known != reminder.versionCode())
+			changes.updated.append(reminder);
+	}
+	for(auto it = knownVersions.constBegin(); it != knownVersions.constEnd(); ++it) {
+		if(!remaining.contains(it.key()))
+			changes.removed.append(it.key());
+	}
+	return changes;
+}
+
+void ReminderIndex::insert(const Reminder &reminder)
+{
+	remove(reminder.id());
+	addEntry(reminder);
+}
+
+bool ReminderIndex::remove(const QUuid &id)
+{
+	auto it = _entries.find(id);
+	if(it == _entries.end())
+		return false;
+
+	if(it->indexed)
+		_byDue.remove(it->due, id);
+	_entries.erase(it);
+	return true;
+}
+
+void ReminderIndex::reset(const QList<Reminder> &reminders)
+{
+	clear();
+	_entries.reserve(reminders.size());
+	for(const auto &reminder : reminders)
+		addEntry(reminder);
+}
+
+void ReminderIndex::clear()
+{
+	_entries.clear();
+	_byDue.clear();
+}
+
+void ReminderIndex::dataChanged(const QString &key, const QVariant &value)
+{
+	if(value.isValid())
+		insert(value.value<Reminder>());
+	else
+		remove(QUuid{key});
+}
+
+void ReminderIndex::dataResetted()
+{
+	Changes changes;
+	try {
+		changes = reconcile(_store->loadAll());
+	} catch(QException &e) {
+		qWarning() << "Failed to reload reminders after a reset with error:" << e.what();
+		changes.removed = _entries.keys();
+		clear();
+	}
+	emit reconciled(changes);
+}
+
+void ReminderIndex::rebuild()
+{
+	reset(reminders());
+}
+
+void ReminderIndex::addEntry(const Reminder &reminder)
+{
+	Entry entry {reminder, false, 0};
+	const auto current = reminder.current();
+	if(current.isValid()) {
+		entry.indexed = true;
+		entry.due = TimeZoneService::instance()->toMSecsSinceEpoch(current);
+		_byDue.insert(entry.due, reminder.id());
+	}
+	_entries.insert(reminder.id(), entry);
+}
+
+QList<Reminder> ReminderIndex::collect(QMultiMap<qint64, QUuid>::const_iterator begin,
+									   QMultiMap<qint64, QUuid>::const_iterator end) const
+{
+	QList<Reminder> reminders;
+	for(auto it = begin; it != end; ++it)
+		reminders.append(reminder(*it));
+	return reminders;
+}
@@ -0,0 +1,85 @@
+#ifndef REMINDERINDEX_H
+#define REMINDERINDEX_H
+
+#include <QHash>
+#include <QMultiMap>
+#include <QObject>
+
+#include "libsyrem_global.h"
+#include "libsyrem.h"
+
+// all reminders of a store by id, with a secondary index ordered by their current (or snoozed) time.
+// Range queries are logarithmic plus the number of results, which are sorted by the due time
+class LIB_SYREM_EXPORT ReminderIndex : public QObject
+{
+	Q_OBJECT
+
+public:
+	// what differs between two states, by id and version code
+	struct Changes {
+		QList<Reminder> added;
+		QList<Reminder> updated;
+		QList<QUuid> removed;
+
+		bool isEmpty() const;
+	};
+
+	explicit ReminderIndex(QObject *parent = nullptr);
+
+	// loads all reminders of the store and follows it's changes from then on. Throws like loadAll.
+	// When the store is resetted, it is reloaded and the differences are reported via reconciled
+	void attach(ReminderStore *store);
+
+	int size() const;
+	bool contains(const QUuid &id) const;
+	// the id must be contained, check with contains first
+	Reminder reminder(const QUuid &id) const;
+	QList<Reminder> reminders() const;
+
+	// whether any reminder has a due time at all
+	bool hasDue() const;
+	// the reminder with the earliest due time. Must only be called if hasDue
+	Reminder nextDue() const;
+	// all reminders that have a due time, sorted by it
+	QList<Reminder> dueReminders() const;
+	// due before time, including the ones already overdue
+	QList<Reminder> dueBefore(const QDateTime &time) const;
+	// due in [from, to)
+	QList<Reminder> dueBetween(const QDateTime &from, const QDateTime &to) const;
+
+	// replaces all reminders like reset, but only touches the ones that actually changed
+	Changes reconcile(const QList<Reminder> &reminders);
+	static Changes diff(const QHash<QUuid, quint32> &knownVersions, const QList<Reminder> &reminders);
+
+public slots:
+	void insert(const Reminder &reminder);
+	bool remove(const QUuid &id);
+	void reset(const QList<Reminder> &reminders);
+	void clear();
+
+signals:
+	void reconciled(const ReminderIndex::Changes &changes);
+
+private slots:
+	void dataChanged(const QString &key, const QVariant &value);
+	void dataResetted();
+	// the wall times stay the same, but the zone may have moved them to another point in time
+	void rebuild();
+
+private:
+	struct Entry {
+		Reminder reminder;
+		bool indexed;
+		qint64 due;
+	};
+
+	ReminderStore *_store = nullptr;
+	QHash<QUuid, Entry> _entries;
+	QMultiMap<qint64, QUuid> _byDue;
+
+	void addEntry(const Reminder &reminder);
+	QList<Reminder> collect(QMultiMap<qint64, QUuid>::const_iterator begin,
+							QMultiMap<qint64, QUuid>::const_iterator end) const;
+};
+
+#endif // REMINDERINDEX_H
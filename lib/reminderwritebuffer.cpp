@@ -0,0 +1,119 @@
+#include "reminderwritebuffer.h"
+#include <QCoreApplication>
+#include <QDebug>
+
+ReminderWriteBuffer::ReminderWriteBuffer(QObject *parent) :
+	ReminderWriteBuffer{QtDataSync::DefaultSetup, parent}
+{}
+
+ReminderWriteBuffer::ReminderWriteBuffer(const QString &setupName, QObject *parent) :
+	QObject{parent},
+	_store{new QtDataSync::DataStore{setupName, this}},
+	_timer{new QTimer{this}}
+{
+	_timer->setSingleShot(true);
+	_timer->setInterval(0);
+	connect(_timer, &QTimer::timeout,
+			this, &ReminderWriteBuffer::timeout);
+	// the destructor of a buffer living until the end of main may run too late for the store
+	if(QCoreApplication::instance()) {
+		connect(qApp, &QCoreApplication::aboutToQuit,
+				this, &ReminderWriteBuffer::timeout);
+	}
+}
+
+ReminderWriteBuffer::~ReminderWriteBuffer()
+{
+	timeout();
+}
+
+QtDataSync::DataStore *ReminderWriteBuffer::store() const
+{
+	return _store;
+}
+
+std::chrono::milliseconds ReminderWriteBuffer::delay() const
+{
+	return std::chrono::milliseconds{_timer->interval()};
+}
+
+void ReminderWriteBuffer::setDelay(std::chrono::milliseconds delay)
+{
+	_timer->setInterval(delay);
+	if(delay.count() == 0)
+		timeout();
+}
+
+bool ReminderWriteBuffer::hasPending() const
+{
+	return !_pending.isEmpty() || !_removals.isEmpty();
+}
+
+bool ReminderWriteBuffer::isPending(const QUuid &id) const
+{
+	return _pending.contains(id) || _removals.contains(id);
+}
+
+void ReminderWriteBuffer::save(const Reminder &reminder)
+{
+	_removals.remove(reminder.id());
+	_pending.insert(reminder.id(), reminder);
+	scheduleFlush();
+}
+
+void ReminderWriteBuffer::remove(const QUuid &id)
+{
+	_pending.remove(id);
+	_removals.insert(id);
+	scheduleFlush();
+}
+
+void ReminderWriteBuffer::flush()
+{
+	_timer->stop();
+	// writes emit the store signals, which may add new pending writes while flushing
+	while(!_pending.isEmpty() || !_removals.isEmpty()) {
+		if(!_pending.isEmpty()) {
+			const auto reminder = *_pending.constBegin();
+			_store->save(reminder);
+			_pending.remove(reminder.id());
+		} else {
+			const auto id = *_removals.constBegin();
+			_store->remove<Reminder>(id);
+			_removals.remove(id);
+		}
+	}
+}
+
+void ReminderWriteBuffer::discardOutdated(const QList<Reminder> &current, const QList<QUuid> &removed)
+{
+	for(const auto &id : removed) {
+		_pending.remove(id);
+		_removals.remove(id);
+	}
+	for(const auto &reminder : current) {
+		const auto it = _pending.find(reminder.id());
+		if(it != _pending.end() && it->versionCode() <= reminder.versionCode())
+			_pending.erase(it);
+	}
+	if(!hasPending())
+		_timer->stop();
+}
+
+void ReminderWriteBuffer::timeout()
+{
+	try {
+		flush();
+	} catch(QException &e) {
+		qCritical() << "Failed to write" << _pending.size() + _removals.size()
+					<< "pending reminder changes with error:" << e.what();
+	}
+}
+
+void ReminderWriteBuffer::scheduleFlush()
+{
+	if(_timer->interval() == 0)
+		flush();
+	else if(!_timer->isActive()) // the first pending write decides, so the delay is never extended
+		_timer->start();
+}
@@ -0,0 +1,58 @@
+#ifndef REMINDERWRITEBUFFER_H
+#define REMINDERWRITEBUFFER_H
+
+#include <chrono>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QtDataSync/DataStore>
+
+#include "libsyrem_global.h"
+#include "reminder.h"
+
+// delays writes of reminders for a short time, so that successive changes of the same reminder, like
+// snoozing and completing it right after, end up as a single save. Pending writes are flushed once the
+// delay after the first of them passed, on flush() and when the buffer or the application is destroyed
+class LIB_SYREM_EXPORT ReminderWriteBuffer : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit ReminderWriteBuffer(QObject *parent = nullptr);
+	explicit ReminderWriteBuffer(const QString &setupName, QObject *parent = nullptr);
+	~ReminderWriteBuffer() override;
+
+	QtDataSync::DataStore *store() const;
+
+	// a delay of 0 writes everything right away
+	std::chrono::milliseconds delay() const;
+	void setDelay(std::chrono::milliseconds delay);
+
+	bool hasPending() const;
+	bool isPending(const QUuid &id) const;
+
+public slots:
+	// replaces any pending write of the same reminder
+	void save(const Reminder &reminder);
+	void remove(const QUuid &id);
+	// throws like the store. Writes that failed stay pending
+	void flush();
+	// drops the pending writes a reload of the stored data made obsolete: saves of removed reminders and
+	// of reminders that now have the same or a newer version. Everything else is still written
+	void discardOutdated(const QList<Reminder> &current, const QList<QUuid> &removed);
+
+private slots:
+	void timeout();
+
+private:
+	QtDataSync::DataStore *_store;
+	QTimer *_timer;
+	// an id is either saved or removed, never both
+	QHash<QUuid, Reminder> _pending;
+	QSet<QUuid> _removals;
+
+	void scheduleFlush();
+};
+
+#endif // REMINDERWRITEBUFFER_H
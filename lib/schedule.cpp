@@ -1,27 +1,128 @@
 #include "schedule.h"
 #include "dateparser.h"
+#include "timezoneservice.h"
+#include <algorithm>
+#include <QMetaProperty>
 using namespace Expressions;
 
+bool ScheduleCursor::operator==(const ScheduleCursor &other) const
+{
+	// the heap is only derived from the sub cursors
+	return current == other.current &&
+			fenceEnd == other.fenceEnd &&
+			subCursors == other.subCursors;
+}
+
+bool ScheduleCursor::operator!=(const ScheduleCursor &other) const
+{
+	return !operator==(other);
+}
+
+
+
 Schedule::Schedule(QObject *parent) :
 	QObject(parent),
-	_current()
+	_cursor()
 {}
 
 Schedule::Schedule(QDateTime since, QObject *parent) :
 	QObject{parent},
-	_current{std::move(since)}
+	_cursor{std::move(since), {}, {}, {}}
 {}
 
 QDateTime Schedule::current() const
 {
-	return _current;
+	return _cursor.current;
+}
+
+ScheduleCursor Schedule::cursor() const
+{
+	return _cursor;
+}
+
+void Schedule::setCursor(ScheduleCursor cursor)
+{
+	_cursor = std::move(cursor);
+}
+
+QDateTime Schedule::next(ScheduleCursor &cursor) const
+{
+	cursor.current = generateNextSchedule(cursor);
+	return cursor.current;
+}
+
+QDateTime Schedule::nextAfter(ScheduleCursor &cursor, const QDateTime &reference) const
+{
+	cursor.current = generateNextScheduleAfter(cursor, reference);
+	return cursor.current;
+}
+
+QSharedPointer<Schedule> Schedule::clone() const
+{
+	// the stored properties are the complete state of a schedule
+	QSharedPointer<Schedule> copy{qobject_cast<Schedule*>(metaObject()->newInstance())};
+	Q_ASSERT_X(copy, Q_FUNC_INFO, "schedules must have an invokable default constructor");
+	for(auto i = QObject::staticMetaObject.propertyCount(); i < metaObject()->propertyCount(); ++i) {
+		const auto property = metaObject()->property(i);
+		if(property.isStored() && property.isWritable())
+			property.write(copy.data(), property.read(this));
+	}
+	return copy;
+}
+
+QVector<QDateTime> Schedule::occurrences(const QDateTime &from, const QDateTime &to, int limit) const
+{
+	// work on a copy of the cursor, so the schedule itself is never touched
+	return occurrences(_cursor, from, to, limit);
+}
+
+QVector<QDateTime> Schedule::occurrences(ScheduleCursor cursor, const QDateTime &from, const QDateTime &to, int limit) const
+{
+	auto next = cursor.current;
+	if(next.isValid() && next < from)
+		next = nextAfter(cursor, from.addMSecs(-1));
+
+	QVector<QDateTime> result;
+	while(next.isValid() && next < to && (limit < 0 || result.size() < limit)) {
+		result.append(next);
+		next = this->next(cursor);
+	}
+	return result;
 }
 
 QDateTime Schedule::nextSchedule()
 {
-	_current = generateNextSchedule();
-	emit currentChanged(_current);
-	return _current;
+	next(_cursor);
+	emit currentChanged(_cursor.current);
+	return _cursor.current;
+}
+
+QDateTime Schedule::nextScheduleAfter(const QDateTime &reference)
+{
+	nextAfter(_cursor, reference);
+	emit currentChanged(_cursor.current);
+	return _cursor.current;
+}
+
+QDateTime Schedule::generateNextScheduleAfter(ScheduleCursor &cursor, const QDateTime &reference) const
+{
+	// step through the schedule until after the reference
+	auto next = generateNextSchedule(cursor);
+	while(next.isValid() && next <= reference) {
+		cursor.current = next;
+		next = generateNextSchedule(cursor);
+	}
+	return next;
+}
+
+ScheduleCursor &Schedule::cursorRef()
+{
+	return _cursor;
+}
+
+void Schedule::setCurrent(QDateTime current)
+{
+	_cursor.current = std::move(current);
 }
 
 
@@ -39,8 +140,9 @@ bool SingularSchedule::isRepeating() const
 	return false;
 }
 
-QDateTime SingularSchedule::generateNextSchedule()
+QDateTime SingularSchedule::generateNextSchedule(ScheduleCursor &cursor) const
 {
+	Q_UNUSED(cursor)
 	return {}; // has no next schedule
 }
 
@@ -54,6 +156,9 @@ RepeatedSchedule::RepeatedSchedule(Expressions::Term loopTerm, Expressions::Term
 	Schedule{std::move(from), parent},
 	loopTerm{std::move(loopTerm)},
 	fenceTerm{std::move(fenceTerm)},
+	loopProgram{this->loopTerm},
+	fenceProgram{this->fenceTerm},
+	recurrence{loopProgram.recurrence()},
 	until{std::move(until)}
 {}
 
@@ -62,9 +167,33 @@ bool RepeatedSchedule::isRepeating() const
 	return true;
 }
 
-QDateTime RepeatedSchedule::generateNextSchedule()
+Term RepeatedSchedule::getLoopTerm() const
+{
+	return loopTerm;
+}
+
+Term RepeatedSchedule::getFenceTerm() const
+{
+	return fenceTerm;
+}
+
+void RepeatedSchedule::setLoopTerm(Term loopTerm)
+{
+	this->loopTerm = std::move(loopTerm);
+	loopProgram = TermProgram{this->loopTerm};
+	recurrence = loopProgram.recurrence();
+}
+
+void RepeatedSchedule::setFenceTerm(Term fenceTerm)
 {
-	const auto last = current();
+	this->fenceTerm = std::move(fenceTerm);
+	fenceProgram = TermProgram{this->fenceTerm};
+}
+
+QDateTime RepeatedSchedule::generateNextSchedule(ScheduleCursor &cursor) const
+{
+	const auto last = cursor.current;
+	auto &fenceEnd = cursor.fenceEnd;
 	auto next = last;
 
 	// check if the initial fences need to be generated
@@ -73,23 +202,23 @@ QDateTime RepeatedSchedule::generateNextSchedule()
 	auto applyFenced = false; // normally, we are not fenced
 	QDateTime fenceBegin;
 	if(!fenceTerm.isEmpty() && !fenceEnd.isValid()) {
-		fenceBegin = generateFences(last);
+		fenceBegin = generateFences(last, fenceEnd);
 		next = fenceBegin;
 		applyFenced = true; // Apply fenced, is the first term in the fence
 	}
 
 	// get the next time on the schedule
-	next = loopTerm.apply(next, applyFenced);
+	next = loopProgram.run(next, applyFenced);
 	// and "fix" it in case it goes below the fence (can happen for weeks)
 
 	// if it exceeds the fence, generate a new fence
 	if(!fenceTerm.isEmpty() && next >= fenceEnd) {
-		const auto nextFence = generateFences(fenceEnd); //use end of last fence as reference
+		const auto nextFence = generateFences(fenceEnd, fenceEnd); //use end of last fence as reference
 		if(next >= fenceEnd) // can happen for absolute fences
 			return {};
 		// Generate the next real sched. based of the nextFence. Only regen if not already within the new fence
 		if(next < nextFence)
-			next = loopTerm.apply(nextFence, true); // Apply fenced, is the first term in the fence
+			next = loopProgram.run(nextFence, true); // Apply fenced, is the first term in the fence
 		// safeguard for potential edge cases
 		if(next >= fenceEnd)
 			return {};
@@ -105,10 +234,91 @@ QDateTime RepeatedSchedule::generateNextSchedule()
 		return next;
 }
 
-QDateTime RepeatedSchedule::generateFences(const QDateTime &current)
+QDateTime RepeatedSchedule::generateNextScheduleAfter(ScheduleCursor &cursor, const QDateTime &reference) const
+{
+	if(fenceTerm.isEmpty()) {
+		// common loops without fences can be calculated directly
+		if(recurrence.kind != TermProgram::Recurrence::Irregular &&
+		   cursor.current.isValid() &&
+		   cursor.current < reference) {
+			const auto next = calcRecurrenceAfter(cursor.current, reference);
+			if(until.isValid() && next > until)
+				return {};
+			else
+				return next;
+		}
+	} else {
+		// skip whole fences that end before the reference. This is only possible if the
+		// first schedule of the next fence is realigned to the fence begin anyways
+		auto &fenceEnd = cursor.fenceEnd;
+		while(fenceEnd.isValid() && fenceEnd <= reference) {
+			const auto last = cursor.current;
+			const auto lastEnd = fenceEnd;
+			const auto nextFence = generateFences(lastEnd, fenceEnd);
+			QDateTime next;
+			if(nextFence.isValid() && loopProgram.run(lastEnd.addMSecs(-1)) < nextFence)
+				next = loopProgram.run(nextFence, true);
+			if(!next.isValid() ||
+			   next >= fenceEnd ||
+			   next <= last ||
+			   (until.isValid() && next > until)) {
+				fenceEnd = lastEnd; // edge case, let the normal steps handle it
+				break;
+			}
+
+			if(next > reference)
+				return next;
+			else
+				cursor.current = next;
+		}
+	}
+
+	return Schedule::generateNextScheduleAfter(cursor, reference);
+}
+
+QDateTime RepeatedSchedule::getFenceEnd() const
+{
+	return cursor().fenceEnd;
+}
+
+void RepeatedSchedule::setFenceEnd(QDateTime fenceEnd)
+{
+	cursorRef().fenceEnd = std::move(fenceEnd);
+}
+
+QDateTime RepeatedSchedule::calcRecurrenceAfter(const QDateTime &last, const QDateTime &reference) const
+{
+	switch(recurrence.kind) {
+	case TermProgram::Recurrence::Interval:
+	{
+		const auto zones = TimeZoneService::instance();
+		const auto elapsed = zones->toMSecsSinceEpoch(reference) - zones->toMSecsSinceEpoch(last);
+		const auto steps = elapsed / (recurrence.count * 1000ll) + 1;
+		return last.addSecs(steps * recurrence.count);
+	}
+	case TermProgram::Recurrence::Daily:
+	{
+		// start at the last schedule before the reference date, and step from there
+		const auto steps = std::max(last.date().daysTo(reference.date()) / recurrence.count, 1ll);
+		auto next = loopProgram.run(last.addDays((steps - 1) * recurrence.count));
+		while(next.isValid() && next <= reference)
+			next = loopProgram.run(next);
+		return next;
+	}
+	case TermProgram::Recurrence::Weekly:
+	case TermProgram::Recurrence::Monthly:
+		// the program always finds the next matching point after the given time
+		return loopProgram.run(reference);
+	default:
+		Q_UNREACHABLE();
+		return {};
+	}
+}
+
+QDateTime RepeatedSchedule::generateFences(const QDateTime &current, QDateTime &fenceEnd) const
 {
 	// get the next fence begin from right after the current "end"
-	auto fenceBegin = fenceTerm.apply(current);
+	auto fenceBegin = fenceProgram.run(current);
 	if(!fenceTerm.hasTimeScope()) // reset time to midnight if not part of the fence
 		fenceBegin.setTime(QTime{0, 0});
 
@@ -161,6 +371,8 @@ MultiSchedule::MultiSchedule(QDateTime since, QObject *parent) :
 void MultiSchedule::addSubSchedule(const QSharedPointer<Schedule> &schedule)
 {
 	subSchedules.append(schedule);
+	cursorRef().subCursors.append(schedule->cursor());
+	buildHeap(cursorRef());
 }
 
 bool MultiSchedule::isRepeating() const
@@ -168,20 +380,86 @@ bool MultiSchedule::isRepeating() const
 	return true;
 }
 
-QDateTime MultiSchedule::generateNextSchedule()
+QList<QSharedPointer<Schedule>> MultiSchedule::getSubSchedules() const
 {
-	QDateTime closest;
-	for(const auto& schedule : qAsConst(subSchedules)) {
-		auto next = schedule->current();
-		while(next.isValid() && next <= current())
-			next = schedule->nextSchedule();
+	// combine definitions and their state again for serialization
+	const auto subCursors = cursor().subCursors;
+	QList<QSharedPointer<Schedule>> schedules;
+	schedules.reserve(subSchedules.size());
+	for(auto i = 0; i < subSchedules.size(); ++i) {
+		auto schedule = subSchedules[i]->clone();
+		schedule->setCursor(subCursors.value(i));
+		schedules.append(schedule);
+	}
+	return schedules;
+}
 
+void MultiSchedule::setSubSchedules(QList<QSharedPointer<Schedule>> subSchedules)
+{
+	this->subSchedules = std::move(subSchedules);
+	auto &cursor = cursorRef();
+	cursor.subCursors.clear();
+	cursor.subCursors.reserve(this->subSchedules.size());
+	for(const auto &schedule : qAsConst(this->subSchedules))
+		cursor.subCursors.append(schedule->cursor());
+	buildHeap(cursor);
+}
+
+QDateTime MultiSchedule::generateNextSchedule(ScheduleCursor &cursor) const
+{
+	return advanceAfter(cursor, cursor.current);
+}
+
+QDateTime MultiSchedule::generateNextScheduleAfter(ScheduleCursor &cursor, const QDateTime &reference) const
+{
+	// every sub schedule can be advanced on it's own, the closest one is the next one
+	return advanceAfter(cursor, cursor.current.isValid() && cursor.current > reference ? cursor.current : reference);
+}
+
+bool MultiSchedule::heapCompare(const ScheduleCursor::HeapEntry &lhs, const ScheduleCursor::HeapEntry &rhs)
+{
+	return lhs.due > rhs.due; // inverted, so the earliest schedule is on top
+}
+
+void MultiSchedule::buildHeap(ScheduleCursor &cursor)
+{
+	const auto zones = TimeZoneService::instance();
+	cursor.heapGeneration = zones->generation();
+	cursor.heap.clear();
+	cursor.heap.reserve(cursor.subCursors.size());
+	for(auto i = 0; i < cursor.subCursors.size(); ++i) {
+		const auto &next = cursor.subCursors[i].current;
+		if(next.isValid())
+			cursor.heap.append({zones->toMSecsSinceEpoch(next), i});
+	}
+	std::make_heap(cursor.heap.begin(), cursor.heap.end(), heapCompare);
+}
+
+QDateTime MultiSchedule::advanceAfter(ScheduleCursor &cursor, const QDateTime &reference) const
+{
+	// the keys are only valid in the zone they were calculated for
+	const auto zones = TimeZoneService::instance();
+	if(cursor.heapGeneration != zones->generation())
+		buildHeap(cursor);
+
+	// advance all sub schedules that are not after the reference, the top one is the next one
+	auto &heap = cursor.heap;
+	const auto refMSecs = zones->toMSecsSinceEpoch(reference);
+	while(!heap.isEmpty()) {
+		const auto top = heap.first();
+		if(!reference.isValid() || top.due > refMSecs)
+			return cursor.subCursors[top.index].current;
+
+		std::pop_heap(heap.begin(), heap.end(), heapCompare);
+		const auto next = subSchedules[top.index]->nextAfter(cursor.subCursors[top.index], reference);
 		if(next.isValid()) {
-			if(!closest.isValid() || closest > next)
-				closest = next;
-		}
+			heap.last() = {zones->toMSecsSinceEpoch(next), top.index};
+			std::push_heap(heap.begin(), heap.end(), heapCompare);
+		} else
+			heap.removeLast();
 	}
-	return closest;
+
+	return {};
 }
 
 
@@ -204,9 +482,9 @@ bool OneTimeSchedule::isRepeating() const
 	return false;
 }
 
-QDateTime OneTimeSchedule::generateNextSchedule()
+QDateTime OneTimeSchedule::generateNextSchedule(ScheduleCursor &cursor) const
 {
-	if(current() < timepoint)
+	if(cursor.current < timepoint)
 		return timepoint;
 	else
 		return {};
@@ -227,13 +505,13 @@ bool LoopSchedule::isRepeating() const
 	return true;
 }
 
-QDateTime LoopSchedule::generateNextSchedule()
+QDateTime LoopSchedule::generateNextSchedule(ScheduleCursor &cursor) const
 {
 	QDateTime tp;
-	if(from.isValid() && current() < from)
+	if(from.isValid() && cursor.current < from)
 		tp = from;
 	else
-		tp = current();
+		tp = cursor.current;
 
 	tp = type->nextDateTime(tp);
 
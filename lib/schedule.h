@@ -3,9 +3,12 @@
 
 #include <QDateTime>
 #include <QObject>
+#include <QSharedPointer>
+#include <QVector>
 
 #include "libsyrem_global.h"
 #include "eventexpressionparser.h"
+#include "termprogram.h"
 
 namespace ParserTypes {
 class Loop;
@@ -13,13 +16,32 @@ class Type;
 class Datum;
 }
 
+// the variable part of a schedule. A schedule itself is only the definition
+class LIB_SYREM_EXPORT ScheduleCursor
+{
+public:
+	struct HeapEntry {
+		qint64 due; // msecs since epoch of the sub cursors current
+		int index;
+	};
+
+	QDateTime current;
+	QDateTime fenceEnd; // repeated schedules only
+	QVector<ScheduleCursor> subCursors; // multi schedules only
+	QVector<HeapEntry> heap; // multi schedules only, min heap of all valid sub cursors
+	quint32 heapGeneration = 0; // multi schedules only, the zone generation the heap was built in
+
+	bool operator==(const ScheduleCursor &other) const;
+	bool operator!=(const ScheduleCursor &other) const;
+};
+
 class LIB_SYREM_EXPORT Schedule : public QObject
 {
 	Q_OBJECT
 	Q_CLASSINFO("polymorphic", "true")
 
 	Q_PROPERTY(bool repeating READ isRepeating STORED false CONSTANT)
-	Q_PROPERTY(QDateTime current READ current MEMBER _current NOTIFY currentChanged)
+	Q_PROPERTY(QDateTime current READ current WRITE setCurrent NOTIFY currentChanged)
 
 public:
 	explicit Schedule(QObject *parent = nullptr);
@@ -28,17 +50,39 @@ public:
 	virtual bool isRepeating() const = 0;
 	QDateTime current() const;
 
+	ScheduleCursor cursor() const;
+	void setCursor(ScheduleCursor cursor);
+
+	// const evaluation, only modifies the given cursor. Can be used from any thread
+	QDateTime next(ScheduleCursor &cursor) const;
+	// same as calling next until the result is after the reference
+	QDateTime nextAfter(ScheduleCursor &cursor, const QDateTime &reference) const;
+
+	// creates an independent copy with the same state
+	virtual QSharedPointer<Schedule> clone() const;
+	// all schedules in [from, to), starting at current. Does not modify the schedule itself
+	QVector<QDateTime> occurrences(const QDateTime &from, const QDateTime &to, int limit = -1) const;
+	// same, but starting at the given cursor instead of the schedules own one
+	QVector<QDateTime> occurrences(ScheduleCursor cursor, const QDateTime &from, const QDateTime &to, int limit = -1) const;
+
 public slots:
 	QDateTime nextSchedule();
+	// same as calling nextSchedule until the result is after the reference, but emits only once
+	QDateTime nextScheduleAfter(const QDateTime &reference);
 
 signals:
 	void currentChanged(QDateTime current);
 
 protected:
-	virtual QDateTime generateNextSchedule() = 0;
+	virtual QDateTime generateNextSchedule(ScheduleCursor &cursor) const = 0;
+	virtual QDateTime generateNextScheduleAfter(ScheduleCursor &cursor, const QDateTime &reference) const;
+
+	ScheduleCursor &cursorRef();
 
 private:
-	QDateTime _current;
+	ScheduleCursor _cursor;
+
+	void setCurrent(QDateTime current);
 };
 
 class LIB_SYREM_EXPORT SingularSchedule : public Schedule
@@ -52,17 +96,17 @@ public:
 	bool isRepeating() const override;
 
 protected:
-	QDateTime generateNextSchedule() override;
+	QDateTime generateNextSchedule(ScheduleCursor &cursor) const override;
 };
 
 class LIB_SYREM_EXPORT RepeatedSchedule : public Schedule
 {
 	Q_OBJECT
 
-	Q_PROPERTY(Expressions::Term loopTerm MEMBER loopTerm)
-	Q_PROPERTY(Expressions::Term fenceTerm MEMBER fenceTerm)
+	Q_PROPERTY(Expressions::Term loopTerm READ getLoopTerm WRITE setLoopTerm)
+	Q_PROPERTY(Expressions::Term fenceTerm READ getFenceTerm WRITE setFenceTerm)
 	Q_PROPERTY(QDateTime until MEMBER until)
-	Q_PROPERTY(QDateTime fenceEnd MEMBER fenceEnd)
+	Q_PROPERTY(QDateTime fenceEnd READ getFenceEnd WRITE setFenceEnd)
 
 public:
 	Q_INVOKABLE RepeatedSchedule(QObject *parent = nullptr);
@@ -74,23 +118,36 @@ public:
 
 	bool isRepeating() const override;
 
+	Expressions::Term getLoopTerm() const;
+	Expressions::Term getFenceTerm() const;
+
+	void setLoopTerm(Expressions::Term loopTerm);
+	void setFenceTerm(Expressions::Term fenceTerm);
+
 protected:
-	QDateTime generateNextSchedule() override;
+	QDateTime generateNextSchedule(ScheduleCursor &cursor) const override;
+	QDateTime generateNextScheduleAfter(ScheduleCursor &cursor, const QDateTime &reference) const override;
 
 private:
 	Expressions::Term loopTerm;
 	Expressions::Term fenceTerm;
+	Expressions::TermProgram loopProgram;
+	Expressions::TermProgram fenceProgram;
+	Expressions::TermProgram::Recurrence recurrence;
 	QDateTime until;
-	QDateTime fenceEnd;
 
-	QDateTime generateFences(const QDateTime &current);
+	QDateTime getFenceEnd() const;
+	void setFenceEnd(QDateTime fenceEnd);
+
+	QDateTime generateFences(const QDateTime &current, QDateTime &fenceEnd) const;
+	QDateTime calcRecurrenceAfter(const QDateTime &last, const QDateTime &reference) const;
 };
 
 class LIB_SYREM_EXPORT MultiSchedule : public Schedule
 {
 	Q_OBJECT
 
-	Q_PROPERTY(QList<QSharedPointer<Schedule>> subSchedules MEMBER subSchedules)
+	Q_PROPERTY(QList<QSharedPointer<Schedule>> subSchedules READ getSubSchedules WRITE setSubSchedules)
 
 public:
 	Q_INVOKABLE MultiSchedule(QObject *parent = nullptr);
@@ -100,11 +157,20 @@ public:
 
 	bool isRepeating() const override;
 
+	QList<QSharedPointer<Schedule>> getSubSchedules() const;
+	void setSubSchedules(QList<QSharedPointer<Schedule>> subSchedules);
+
 protected:
-	QDateTime generateNextSchedule() override;
+	QDateTime generateNextSchedule(ScheduleCursor &cursor) const override;
+	QDateTime generateNextScheduleAfter(ScheduleCursor &cursor, const QDateTime &reference) const override;
 
 private:
+	// only the definitions, the state of each sub schedule is part of the cursor
 	QList<QSharedPointer<Schedule>> subSchedules;
+
+	static bool heapCompare(const ScheduleCursor::HeapEntry &lhs, const ScheduleCursor::HeapEntry &rhs);
+	static void buildHeap(ScheduleCursor &cursor);
+	QDateTime advanceAfter(ScheduleCursor &cursor, const QDateTime &reference) const;
 };
 
 // historic schedules MAJOR convert and remove
@@ -122,7 +188,7 @@ public:
 	bool isRepeating() const override;
 
 protected:
-	QDateTime generateNextSchedule() override;
+	QDateTime generateNextSchedule(ScheduleCursor &cursor) const override;
 
 private:
 	QDateTime timepoint;
@@ -165,7 +231,7 @@ public:
 	bool isRepeating() const override;
 
 protected:
-	QDateTime generateNextSchedule() override;
+	QDateTime generateNextSchedule(ScheduleCursor &cursor) const override;
 
 private:
 	ParserTypes::Type *type = nullptr;
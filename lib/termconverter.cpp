@@ -1,9 +1,94 @@
 #include "termconverter.h"
 #include "eventexpressionparser.h"
+#include "terms.h"
 #include <QJsonArray>
+#include <QJsonObject>
 #include <QJsonSerializerException>
 using namespace Expressions;
 
+namespace {
+
+const QString ClassKey = QStringLiteral("@class");
+const QString TypeKey = QStringLiteral("type");
+const QString ScopeKey = QStringLiteral("scope");
+
+template <typename TSubTerm>
+SubTerm *createTerm()
+{
+	return new TSubTerm{static_cast<QObject*>(nullptr)};
+}
+
+// same as QJsonValue::fromVariant, which the generic serialization uses for these
+QJsonValue timeToJson(const QTime &time)
+{
+	if(time.isValid())
+		return time.toString(Qt::ISODateWithMs);
+	else
+		return QJsonValue::Null;
+}
+
+QTime timeFromJson(const QJsonValue &value)
+{
+	return QTime::fromString(value.toString(), Qt::ISODate);
+}
+
+QJsonValue dateToJson(const QDate &date)
+{
+	if(date.isValid())
+		return date.toString(Qt::ISODate);
+	else
+		return QJsonValue::Null;
+}
+
+QDate dateFromJson(const QJsonValue &value)
+{
+	return QDate::fromString(value.toString(), Qt::ISODate);
+}
+
+// the names QMetaEnum::valueToKey returns for the scope flags
+QString scopeToKey(SubTerm::Scope scope)
+{
+	switch(static_cast<int>(scope)) {
+	case SubTerm::InvalidScope:
+		return QStringLiteral("InvalidScope");
+	case SubTerm::Minute:
+		return QStringLiteral("Minute");
+	case SubTerm::Hour:
+		return QStringLiteral("Hour");
+	case SubTerm::Day:
+		return QStringLiteral("Day");
+	case SubTerm::Week:
+		return QStringLiteral("Week");
+	case SubTerm::MonthDay:
+		return QStringLiteral("MonthDay");
+	case SubTerm::Month:
+		return QStringLiteral("Month");
+	case SubTerm::Year:
+		return QStringLiteral("Year");
+	default:
+		return {};
+	}
+}
+
+SubTerm::ScopeFlag scopeFromKey(const QString &key)
+{
+	static const QHash<QString, SubTerm::ScopeFlag> scopes {
+		{QStringLiteral("InvalidScope"), SubTerm::InvalidScope},
+		{QStringLiteral("Minute"), SubTerm::Minute},
+		{QStringLiteral("Hour"), SubTerm::Hour},
+		{QStringLiteral("Day"), SubTerm::Day},
+		{QStringLiteral("WeekDay"), SubTerm::WeekDay},
+		{QStringLiteral("Week"), SubTerm::Week},
+		{QStringLiteral("MonthDay"), SubTerm::MonthDay},
+		{QStringLiteral("Month"), SubTerm::Month},
+		{QStringLiteral("Year"), SubTerm::Year}
+	};
+	// QMetaEnum::keyToValue reports unknown keys as -1
+	return scopes.value(key, static_cast<SubTerm::ScopeFlag>(-1));
+}
+
+}
+
 bool TermConverter::canConvert(int metaTypeId) const
 {
 	return metaTypeId == qMetaTypeId<Term>();
@@ -19,12 +104,27 @@ QJsonValue TermConverter::serialize(int propertyType, const QVariant &value, con
 	if(propertyType != qMetaTypeId<Term>())
 		throw QJsonSerializationException{"Unsupported property type. Must be Expressions::Term"};
 
+	const auto &types = termTypes();
+	const auto useTable = canUseTable(helper);
+
 	auto index = 0;
 	QJsonArray array;
 	for(const auto &subTerm : value.value<Term>()) {
-		array.append(helper->serializeSubtype(qMetaTypeId<SubTerm*>(),
-											  QVariant::fromValue(subTerm.data()),
-											  "[" + QByteArray::number(index++) + "]"));
+		const auto className = QString::fromUtf8(subTerm->metaObject()->className());
+		const auto type = useTable ? types.constFind(className) : types.constEnd();
+		if(type != types.constEnd()) {
+			QJsonObject object;
+			object.insert(ClassKey, className);
+			object.insert(TypeKey, static_cast<int>(subTerm->type));
+			object.insert(ScopeKey, static_cast<int>(subTerm->scope));
+			type->write(subTerm.data(), object);
+			array.append(object);
+		} else {
+			array.append(helper->serializeSubtype(qMetaTypeId<SubTerm*>(),
+												  QVariant::fromValue(subTerm.data()),
+												  "[" + QByteArray::number(index) + "]"));
+		}
+		index++;
 	}
 	return array;
 }
@@ -35,21 +135,143 @@ QVariant TermConverter::deserialize(int propertyType, const QJsonValue &value, Q
 	if(propertyType != qMetaTypeId<Term>())
 		throw QJsonDeserializationException{"Unsupported property type. Must be Expressions::Term"};
 
+	const auto &types = termTypes();
+	const auto useTable = canUseTable(helper);
+
 	auto index = 0;
 	auto array = value.toArray();
 	Term term;
 	term.reserve(array.size());
 	for(auto val : array) {
-		auto subTerm = helper->deserializeSubtype(qMetaTypeId<SubTerm*>(),
-												  val,
-												  nullptr,
-												  "[" + QByteArray::number(index++) + "]").value<SubTerm*>();
-		if(!subTerm)
-			throw QJsonDeserializationException{"Value returned from subterm element in json was not a Expressions::SubTerm"};
-		subTerm->setParent(nullptr); //to be shure
+		const auto object = val.toObject();
+		const auto type = useTable ? types.constFind(object.value(ClassKey).toString()) : types.constEnd();
+		SubTerm *subTerm = nullptr;
+		if(type != types.constEnd()) {
+			subTerm = type->create();
+			subTerm->type = SubTerm::Type{QFlag{object.value(TypeKey).toInt()}};
+			subTerm->scope = SubTerm::Scope{QFlag{object.value(ScopeKey).toInt()}};
+			type->read(subTerm, object);
+		} else {
+			subTerm = helper->deserializeSubtype(qMetaTypeId<SubTerm*>(),
+												 val,
+												 nullptr,
+												 "[" + QByteArray::number(index) + "]").value<SubTerm*>();
+			if(!subTerm)
+				throw QJsonDeserializationException{"Value returned from subterm element in json was not a Expressions::SubTerm"};
+			subTerm->setParent(nullptr); //to be shure
+		}
 		term.append(QSharedPointer<SubTerm>{subTerm});
+		index++;
 	}
 
 	term.finalize();
 	return QVariant::fromValue(term);
 }
+
+const QHash<QString, TermConverter::TermType> &TermConverter::termTypes()
+{
+	// the keys are the class names the generic serialization writes to "@class"
+	static const QHash<QString, TermType> types {
+		{QString::fromUtf8(TimeTerm::staticMetaObject.className()), {
+			 &createTerm<TimeTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 object.insert(QStringLiteral("time"), timeToJson(static_cast<const TimeTerm*>(subTerm)->_time));
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 static_cast<TimeTerm*>(subTerm)->_time = timeFromJson(object.value(QStringLiteral("time")));
+			 }
+		 }},
+		{QString::fromUtf8(DateTerm::staticMetaObject.className()), {
+			 &createTerm<DateTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 object.insert(QStringLiteral("date"), dateToJson(static_cast<const DateTerm*>(subTerm)->_date));
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 static_cast<DateTerm*>(subTerm)->_date = dateFromJson(object.value(QStringLiteral("date")));
+			 }
+		 }},
+		{QString::fromUtf8(InvertedTimeTerm::staticMetaObject.className()), {
+			 &createTerm<InvertedTimeTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 object.insert(QStringLiteral("time"), timeToJson(static_cast<const InvertedTimeTerm*>(subTerm)->_time));
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 static_cast<InvertedTimeTerm*>(subTerm)->_time = timeFromJson(object.value(QStringLiteral("time")));
+			 }
+		 }},
+		{QString::fromUtf8(MonthDayTerm::staticMetaObject.className()), {
+			 &createTerm<MonthDayTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 object.insert(QStringLiteral("day"), static_cast<const MonthDayTerm*>(subTerm)->_day);
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 static_cast<MonthDayTerm*>(subTerm)->_day = object.value(QStringLiteral("day")).toInt();
+			 }
+		 }},
+		{QString::fromUtf8(WeekDayTerm::staticMetaObject.className()), {
+			 &createTerm<WeekDayTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 object.insert(QStringLiteral("weekDay"), static_cast<const WeekDayTerm*>(subTerm)->_weekDay);
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 static_cast<WeekDayTerm*>(subTerm)->_weekDay = object.value(QStringLiteral("weekDay")).toInt();
+			 }
+		 }},
+		{QString::fromUtf8(MonthTerm::staticMetaObject.className()), {
+			 &createTerm<MonthTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 object.insert(QStringLiteral("month"), static_cast<const MonthTerm*>(subTerm)->_month);
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 static_cast<MonthTerm*>(subTerm)->_month = object.value(QStringLiteral("month")).toInt();
+			 }
+		 }},
+		{QString::fromUtf8(YearTerm::staticMetaObject.className()), {
+			 &createTerm<YearTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 object.insert(QStringLiteral("year"), static_cast<const YearTerm*>(subTerm)->_year);
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 static_cast<YearTerm*>(subTerm)->_year = object.value(QStringLiteral("year")).toInt();
+			 }
+		 }},
+		{QString::fromUtf8(SequenceTerm::staticMetaObject.className()), {
+			 &createTerm<SequenceTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 const auto &sequence = static_cast<const SequenceTerm*>(subTerm)->_sequence;
+				 QJsonObject sequenceObject;
+				 for(auto it = sequence.constBegin(); it != sequence.constEnd(); ++it)
+					 sequenceObject.insert(scopeToKey(it.key()), it.value());
+				 object.insert(QStringLiteral("sequence"), sequenceObject);
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 auto &sequence = static_cast<SequenceTerm*>(subTerm)->_sequence;
+				 const auto sequenceObject = object.value(QStringLiteral("sequence")).toObject();
+				 for(auto it = sequenceObject.constBegin(); it != sequenceObject.constEnd(); ++it)
+					 sequence.insert(scopeFromKey(it.key()), it.value().toInt());
+			 }
+		 }},
+		{QString::fromUtf8(KeywordTerm::staticMetaObject.className()), {
+			 &createTerm<KeywordTerm>,
+			 [](const SubTerm *subTerm, QJsonObject &object) {
+				 object.insert(QStringLiteral("days"), static_cast<const KeywordTerm*>(subTerm)->_days);
+			 },
+			 [](SubTerm *subTerm, const QJsonObject &object) {
+				 static_cast<KeywordTerm*>(subTerm)->_days = object.value(QStringLiteral("days")).toInt();
+			 }
+		 }},
+		{QString::fromUtf8(LimiterTerm::staticMetaObject.className()), {
+			 &createTerm<LimiterTerm>,
+			 [](const SubTerm *, QJsonObject &) {},
+			 [](SubTerm *, const QJsonObject &) {}
+		 }}
+	};
+	return types;
+}
+
+bool TermConverter::canUseTable(const QJsonTypeConverter::SerializationHelper *helper)
+{
+	// the table writes flags as numbers and skips the object name, just like the serializer does by default
+	return !helper->getProperty("enumAsString").toBool() &&
+			!helper->getProperty("keepObjectName").toBool();
+}
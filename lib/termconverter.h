@@ -1,8 +1,16 @@
 #ifndef TERMCONVERTER_H
 #define TERMCONVERTER_H
 
+#include <QHash>
+#include <QJsonObject>
 #include <QJsonTypeConverter>
 
+namespace Expressions {
+class SubTerm;
+}
+
+// converts the known subterms directly via a table of their fields, and only falls back to the
+// generic, property based serialization for types not in the table. Both produce the same json
 class TermConverter : public QJsonTypeConverter
 {
 public:
@@ -10,6 +18,16 @@ public:
 	QList<QJsonValue::Type> jsonTypes() const override;
 	QJsonValue serialize(int propertyType, const QVariant &value, const SerializationHelper *helper) const override;
 	QVariant deserialize(int propertyType, const QJsonValue &value, QObject *parent, const SerializationHelper *helper) const override;
+
+private:
+	struct TermType {
+		Expressions::SubTerm *(*create)();
+		void (*write)(const Expressions::SubTerm *subTerm, QJsonObject &object);
+		void (*read)(Expressions::SubTerm *subTerm, const QJsonObject &object);
+	};
+
+	static const QHash<QString, TermType> &termTypes();
+	static bool canUseTable(const SerializationHelper *helper);
 };
 
 #endif // TERMCONVERTER_H
@@ -0,0 +1,251 @@
+#include "termprogram.h"
+#include "timezoneservice.h"
+#include <chrono>
+#include <QTimeZone>
+using namespace Expressions;
+
+TermProgram::TermProgram(const Term &term) :
+	_valid{!term.isEmpty()}
+{
+	// same evaluation order as Term::apply, but resolved only once
+	_section = ApplySection;
+	_fenced = false;
+	for(const auto &subTerm : term) {
+		if(subTerm->type.testFlag(SubTerm::FlagLimiter)) // limiters are never applied
+			continue;
+		subTerm->compile(*this);
+		if(subTerm->type.testFlag(SubTerm::Timepoint))
+			_fenced = true;
+	}
+
+	if(_valid) {
+		_section = FixupSection;
+		_fenced = false;
+		term.first()->compileFixup(*this);
+
+		_section = CleanupSection;
+		for(const auto &subTerm : term) {
+			if(subTerm->type.testFlag(SubTerm::FlagNeedsFixupCleanup))
+				subTerm->compileFixupCleanup(*this);
+		}
+	}
+
+	_section = ApplySection;
+	_fenced = false;
+}
+
+bool TermProgram::isEmpty() const
+{
+	return !_valid;
+}
+
+QDateTime TermProgram::run(const QDateTime &datetime, bool applyFenced) const
+{
+	auto civil = toCivil(datetime);
+	exec(_apply, civil, applyFenced);
+	auto appointment = toDateTime(civil);
+
+	const auto zones = TimeZoneService::instance();
+	if(_valid && zones->toMSecsSinceEpoch(appointment) <= zones->toMSecsSinceEpoch(datetime)) {
+		civil = toCivil(appointment);
+		exec(_fixup, civil, false);
+		exec(_cleanup, civil, false);
+		appointment = toDateTime(civil);
+	}
+
+	return appointment;
+}
+
+TermProgram::Recurrence TermProgram::recurrence() const
+{
+	if(!_valid)
+		return {};
+
+	// every N days/weeks at a fixed time or every N hours/minutes
+	if(_fixup.isEmpty() && _cleanup.isEmpty()) {
+		Recurrence recurrence;
+		qint64 seconds = 0;
+		qint64 days = 0;
+		auto hasTime = false;
+		for(const auto &instr : _apply) {
+			if(hasTime || (instr.flags & Fenced) != 0)
+				return {};
+			switch(instr.op) {
+			case AddMinutes:
+				seconds += instr.arg0 * 60ll;
+				break;
+			case AddHours:
+				seconds += instr.arg0 * 3600ll;
+				break;
+			case AddDays:
+				days += instr.arg0;
+				break;
+			case AddWeeks:
+				days += instr.arg0 * 7ll;
+				break;
+			case SetTime:
+				hasTime = true;
+				recurrence.time = instr.arg0;
+				break;
+			default:
+				return {};
+			}
+		}
+
+		// days keep the wall time, which is only stable if the time is reset each time
+		if(seconds > 0 && days == 0 && !hasTime) {
+			recurrence.kind = Recurrence::Interval;
+			recurrence.count = seconds;
+		} else if(days > 0 && seconds == 0 && hasTime) {
+			recurrence.kind = Recurrence::Daily;
+			recurrence.count = days;
+		}
+		return recurrence;
+	}
+
+	// a timepoint with a fixed time, that moves on by it's own scope
+	if(_apply.size() != 2 || _apply[1].op != SetTime)
+		return {};
+	const auto &point = _apply[0];
+	if(point.op == SetWeekDay &&
+	   _fixup.size() == 1 && _fixup[0].op == AddDays && _fixup[0].arg0 == 7)
+		return {Recurrence::Weekly, 0, point.arg0, _apply[1].arg0};
+	else if(point.op == SetDay &&
+			_fixup.size() == 2 && _fixup[0].op == AddMonths && _fixup[0].arg0 == 1 &&
+			_cleanup.isEmpty())
+		return {Recurrence::Monthly, 0, point.arg0, _apply[1].arg0};
+	else
+		return {};
+}
+
+void TermProgram::append(OpCode op, int arg0, int arg1, int arg2, quint8 flags)
+{
+	if(_fenced)
+		flags |= Fenced;
+
+	const Instruction instruction {op, flags, arg0, arg1, arg2};
+	switch(_section) {
+	case ApplySection:
+		_apply.append(instruction);
+		break;
+	case FixupSection:
+		_fixup.append(instruction);
+		break;
+	case CleanupSection:
+		_cleanup.append(instruction);
+		break;
+	default:
+		Q_UNREACHABLE();
+		break;
+	}
+}
+
+void TermProgram::exec(const QVector<Instruction> &code, CivilTime &civil, bool applyFenced)
+{
+	using namespace std::chrono;
+	for(const auto &instr : code) {
+		// absolute offsets depend on the actual utc offset, so they are collected and
+		// only applied on a real datetime once a calendar operation follows
+		if(instr.op == AddMinutes) {
+			civil.pendingSecs += duration_cast<seconds>(minutes{instr.arg0}).count();
+			continue;
+		} else if(instr.op == AddHours) {
+			civil.pendingSecs += duration_cast<seconds>(hours{instr.arg0}).count();
+			continue;
+		} else if(civil.pendingSecs != 0)
+			civil = toCivil(toDateTime(civil));
+		civil.modified = true;
+
+		const auto fenced = applyFenced || (instr.flags & Fenced) != 0;
+		const auto delta = fenced && (instr.flags & FencedOffset) != 0 ?
+							   instr.arg0 - 1 :
+							   instr.arg0;
+		auto &date = civil.date;
+		switch(instr.op) {
+		case SetTime:
+			civil.msecs = instr.arg0;
+			break;
+		case SetDate:
+			date.setDate(instr.arg0, instr.arg1, instr.arg2);
+			break;
+		case SetMonthAndDay:
+			date.setDate(date.year(), instr.arg0, instr.arg1);
+			break;
+		case SetDay:
+			date.setDate(date.year(), date.month(), std::min(instr.arg0, date.daysInMonth()));
+			break;
+		case SetWeekDay:
+			date = applyWeekDay(date, instr.arg0, fenced);
+			break;
+		case SetMonth:
+			date.setDate(date.year(), instr.arg0, 1);
+			break;
+		case SetYear:
+			date.setDate(instr.arg0, 1, 1);
+			break;
+		case AddDays:
+			date = date.addDays(delta);
+			break;
+		case AddWeeks:
+			date = date.addDays(static_cast<qint64>(delta) * 7ll);
+			break;
+		case AddMonths:
+			date = date.addMonths(delta);
+			break;
+		case AddYears:
+			date = date.addYears(delta);
+			break;
+		case FixWeekDay:
+			if(date.dayOfWeek() != instr.arg0)
+				date = applyWeekDay(date, instr.arg0, true);
+			break;
+		default:
+			Q_UNREACHABLE();
+			break;
+		}
+	}
+}
+
+TermProgram::CivilTime TermProgram::toCivil(const QDateTime &datetime)
+{
+	return {datetime, datetime.date(), datetime.time().msecsSinceStartOfDay(), 0, false};
+}
+
+QDateTime TermProgram::toDateTime(const CivilTime &civil)
+{
+	// the wall time is resolved only here, so gaps and overlaps of the
+	// timezone are handled exactly once
+	auto datetime = civil.origin;
+	if(civil.modified) {
+		const auto time = QTime::fromMSecsSinceStartOfDay(civil.msecs);
+		switch(civil.origin.timeSpec()) {
+		case Qt::OffsetFromUTC:
+			datetime = QDateTime{civil.date, time, Qt::OffsetFromUTC, civil.origin.offsetFromUtc()};
+			break;
+		case Qt::TimeZone:
+			datetime = QDateTime{civil.date, time, civil.origin.timeZone()};
+			break;
+		case Qt::LocalTime:
+			datetime = TimeZoneService::instance()->toLocalTime(civil.date, time);
+			break;
+		default:
+			datetime = QDateTime{civil.date, time, civil.origin.timeSpec()};
+			break;
+		}
+	}
+
+	if(civil.pendingSecs != 0)
+		datetime = datetime.addSecs(civil.pendingSecs);
+	return datetime;
+}
+
+QDate TermProgram::applyWeekDay(const QDate &date, int weekDay, bool fenced)
+{
+	// same as WeekDayTerm::apply
+	auto res = date.addDays(weekDay - date.dayOfWeek());
+	if(fenced && res.month() < date.month())
+		res = res.addDays(7);
+	else if(fenced && res.month() > date.month())
+		res = res.addDays(-7);
+	return res;
+}
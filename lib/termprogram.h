@@ -0,0 +1,107 @@
+#ifndef TERMPROGRAM_H
+#define TERMPROGRAM_H
+
+#include <QDateTime>
+#include <QVector>
+
+#include "libsyrem_global.h"
+#include "eventexpressionparser.h"
+
+namespace Expressions {
+
+class LIB_SYREM_EXPORT TermProgram
+{
+public:
+	enum OpCode : quint8 {
+		SetTime, // arg0: msecs since start of day
+		SetDate, // arg0: year, arg1: month, arg2: day
+		SetMonthAndDay, // arg0: month, arg1: day
+		SetDay, // arg0: day, shortened to the days of the month
+		SetWeekDay, // arg0: weekday, kept within the month when fenced
+		SetMonth, // arg0: month, resets the day
+		SetYear, // arg0: year, resets month and day
+		AddMinutes,
+		AddHours,
+		AddDays,
+		AddWeeks,
+		AddMonths,
+		AddYears,
+		FixWeekDay // arg0: weekday, reapplied fenced if the weekday got lost
+	};
+
+	enum InstructionFlag : quint8 {
+		NoFlags = 0x00,
+		Fenced = 0x01, // a timepoint was applied before this instruction
+		FencedOffset = 0x02 // the argument is reduced by one when fenced
+	};
+
+	struct Instruction {
+		OpCode op;
+		quint8 flags;
+		int arg0;
+		int arg1;
+		int arg2;
+	};
+
+	// common shapes of loop programs, which allow a direct calculation of later results
+	struct Recurrence {
+		enum Kind : quint8 {
+			Irregular,
+			Interval, // count: seconds between two results
+			Daily, // count: days between two results, time: msecs since start of day
+			Weekly, // day: weekday, time: msecs since start of day
+			Monthly // day: day of the month, time: msecs since start of day
+		};
+
+		Kind kind = Irregular;
+		qint64 count = 0;
+		int day = 0;
+		int time = 0;
+	};
+
+	TermProgram() = default;
+	explicit TermProgram(const Term &term);
+
+	bool isEmpty() const;
+	QDateTime run(const QDateTime &datetime, bool applyFenced = false) const;
+	Recurrence recurrence() const;
+
+	// used by the subterms to compile themselves
+	void append(OpCode op, int arg0 = 0, int arg1 = 0, int arg2 = 0, quint8 flags = NoFlags);
+
+private:
+	enum Section : quint8 {
+		ApplySection,
+		FixupSection,
+		CleanupSection
+	};
+
+	// broken down wall time, only converted to a real datetime when needed
+	struct CivilTime {
+		QDateTime origin;
+		QDate date;
+		int msecs;
+		qint64 pendingSecs;
+		bool modified;
+	};
+
+	QVector<Instruction> _apply;
+	QVector<Instruction> _fixup;
+	QVector<Instruction> _cleanup;
+	bool _valid = false;
+
+	// compile state
+	Section _section = ApplySection;
+	bool _fenced = false;
+
+	static void exec(const QVector<Instruction> &code, CivilTime &civil, bool applyFenced);
+	static CivilTime toCivil(const QDateTime &datetime);
+	static QDateTime toDateTime(const CivilTime &civil);
+	static QDate applyWeekDay(const QDate &date, int weekDay, bool fenced);
+};
+
+}
+
+Q_DECLARE_TYPEINFO(Expressions::TermProgram::Instruction, Q_PRIMITIVE_TYPE);
+
+#endif // TERMPROGRAM_H
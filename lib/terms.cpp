@@ -51,6 +51,16 @@ void TimeTerm::fixup(QDateTime &datetime) const
 	datetime = datetime.addDays(1);
 }
 
+void TimeTerm::compile(TermProgram &program) const
+{
+	program.append(TermProgram::SetTime, _time.msecsSinceStartOfDay());
+}
+
+void TimeTerm::compileFixup(TermProgram &program) const
+{
+	program.append(TermProgram::AddDays, 1);
+}
+
 QString TimeTerm::describe() const
 {
 	return QLocale().toString(_time, tr("hh:mm"));
@@ -191,6 +201,20 @@ void DateTerm::fixup(QDateTime &datetime) const
 		datetime = datetime.addYears(1);
 }
 
+void DateTerm::compile(TermProgram &program) const
+{
+	if(scope.testFlag(Year))
+		program.append(TermProgram::SetDate, _date.year(), _date.month(), _date.day());
+	else
+		program.append(TermProgram::SetMonthAndDay, _date.month(), _date.day());
+}
+
+void DateTerm::compileFixup(TermProgram &program) const
+{
+	if(!scope.testFlag(Year))
+		program.append(TermProgram::AddYears, 1);
+}
+
 QString DateTerm::describe() const
 {
 	return QLocale().toString(_date, scope.testFlag(Year) ?  tr("yyyy-MM-dd") : tr("MM-dd"));
@@ -333,6 +357,16 @@ void InvertedTimeTerm::fixup(QDateTime &datetime) const
 	datetime = datetime.addDays(1);
 }
 
+void InvertedTimeTerm::compile(TermProgram &program) const
+{
+	program.append(TermProgram::SetTime, _time.msecsSinceStartOfDay());
+}
+
+void InvertedTimeTerm::compileFixup(TermProgram &program) const
+{
+	program.append(TermProgram::AddDays, 1);
+}
+
 QString InvertedTimeTerm::describe() const
 {
 	return QLocale().toString(_time, tr("hh:mm"));
@@ -462,6 +496,17 @@ void MonthDayTerm::fixup(QDateTime &datetime) const
 	apply(datetime, false); //apply again to fix the day for cases like "every 31st"
 }
 
+void MonthDayTerm::compile(TermProgram &program) const
+{
+	program.append(TermProgram::SetDay, _day);
+}
+
+void MonthDayTerm::compileFixup(TermProgram &program) const
+{
+	program.append(TermProgram::AddMonths, 1);
+	program.append(TermProgram::SetDay, _day);
+}
+
 QString MonthDayTerm::describe() const
 {
 	return tr("%1.").arg(_day);
@@ -602,6 +647,21 @@ void WeekDayTerm::fixupCleanup(QDateTime &datetime) const
 		apply(datetime, true);
 }
 
+void WeekDayTerm::compile(TermProgram &program) const
+{
+	program.append(TermProgram::SetWeekDay, _weekDay);
+}
+
+void WeekDayTerm::compileFixup(TermProgram &program) const
+{
+	program.append(TermProgram::AddDays, 7);
+}
+
+void WeekDayTerm::compileFixupCleanup(TermProgram &program) const
+{
+	program.append(TermProgram::FixWeekDay, _weekDay);
+}
+
 QString WeekDayTerm::describe() const
 {
 	return QLocale().standaloneDayName(_weekDay, QLocale::LongFormat);
@@ -726,6 +786,16 @@ void MonthTerm::fixup(QDateTime &datetime) const
 	datetime = datetime.addYears(1);
 }
 
+void MonthTerm::compile(TermProgram &program) const
+{
+	program.append(TermProgram::SetMonth, _month);
+}
+
+void MonthTerm::compileFixup(TermProgram &program) const
+{
+	program.append(TermProgram::AddYears, 1);
+}
+
 QString MonthTerm::describe() const
 {
 	return QLocale().standaloneMonthName(_month, QLocale::LongFormat);
@@ -797,6 +867,11 @@ void YearTerm::apply(QDateTime &datetime, bool applyFenced) const
 	datetime.setDate({_year, 1, 1}); //set the year and reset month/date. They will be specified as needed
 }
 
+void YearTerm::compile(TermProgram &program) const
+{
+	program.append(TermProgram::SetYear, _year);
+}
+
 QString YearTerm::describe() const
 {
 	return QStringLiteral("%1").arg(_year, 4, 10, QLatin1Char('0'));
@@ -947,27 +1022,77 @@ std::pair<QSharedPointer<SequenceTerm>, int> SequenceTerm::parse(const QStringRe
 
 void SequenceTerm::apply(QDateTime &datetime, bool applyFenced) const
 {
+	// the parts are applied in key order, so minutes and hours come before the calendar parts
+	// calendar parts are added to the plain date, and pending time parts are flushed before each of them
 	using namespace std::chrono;
+	auto date = datetime.date();
+	qint64 secs = 0;
+	const auto flushSecs = [&]() {
+		if(secs == 0)
+			return;
+		if(date != datetime.date())
+			datetime.setDate(date);
+		datetime = datetime.addSecs(secs);
+		date = datetime.date();
+		secs = 0;
+	};
 	for(auto it = _sequence.constBegin(); it != _sequence.constEnd(); ++it) {
 		const auto delta = applyFenced ? (*it - 1) : *it;
 		switch(it.key()) {
 		case Minute:
-			datetime = datetime.addSecs(duration_cast<seconds>(minutes{*it}).count());
+			secs += duration_cast<seconds>(minutes{*it}).count();
 			break;
 		case Hour:
-			datetime = datetime.addSecs(duration_cast<seconds>(hours{*it}).count());
+			secs += duration_cast<seconds>(hours{*it}).count();
 			break;
 		case Day:
-			datetime = datetime.addDays(delta);
+			flushSecs();
+			date = date.addDays(delta);
 			break;
 		case Week:
-			datetime = datetime.addDays(static_cast<qint64>(delta) * 7ll);
+			flushSecs();
+			date = date.addDays(static_cast<qint64>(delta) * 7ll);
 			break;
 		case Month:
-			datetime = datetime.addMonths(delta);
+			flushSecs();
+			date = date.addMonths(delta);
 			break;
 		case Year:
-			datetime = datetime.addYears(delta);
+			flushSecs();
+			date = date.addYears(delta);
+			break;
+		default:
+			Q_UNREACHABLE();
+			break;
+		}
+	}
+
+	flushSecs();
+	if(date != datetime.date())
+		datetime.setDate(date);
+}
+
+void SequenceTerm::compile(TermProgram &program) const
+{
+	for(auto it = _sequence.constBegin(); it != _sequence.constEnd(); ++it) {
+		switch(it.key()) {
+		case Minute:
+			program.append(TermProgram::AddMinutes, *it);
+			break;
+		case Hour:
+			program.append(TermProgram::AddHours, *it);
+			break;
+		case Day:
+			program.append(TermProgram::AddDays, *it, 0, 0, TermProgram::FencedOffset);
+			break;
+		case Week:
+			program.append(TermProgram::AddWeeks, *it, 0, 0, TermProgram::FencedOffset);
+			break;
+		case Month:
+			program.append(TermProgram::AddMonths, *it, 0, 0, TermProgram::FencedOffset);
+			break;
+		case Year:
+			program.append(TermProgram::AddYears, *it, 0, 0, TermProgram::FencedOffset);
 			break;
 		default:
 			Q_UNREACHABLE();
@@ -1087,6 +1212,11 @@ void KeywordTerm::apply(QDateTime &datetime, bool applyFenced) const
 	datetime = datetime.addDays(_days);
 }
 
+void KeywordTerm::compile(TermProgram &program) const
+{
+	program.append(TermProgram::AddDays, _days);
+}
+
 QString KeywordTerm::describe() const
 {
 	return tr("in %n day(s)", "", _days);
@@ -1146,6 +1276,11 @@ void LimiterTerm::apply(QDateTime &datetime, bool applyFenced) const
 	Q_UNUSED(datetime)
 }
 
+void LimiterTerm::compile(TermProgram &program) const
+{
+	Q_UNUSED(program) // limiters are skipped when applying
+}
+
 QString LimiterTerm::describe() const
 {
 	return {};
@@ -2,6 +2,7 @@
 #define TERMS_H
 
 #include "eventexpressionparser.h"
+#include "termprogram.h"
 
 namespace Expressions {
 
@@ -70,11 +71,14 @@ public:
 	static std::pair<QSharedPointer<TimeTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool keepOffset) const override;
 	void fixup(QDateTime &datetime) const override;
+	void compile(TermProgram &program) const override;
+	void compileFixup(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	QTime _time;
 
 	static QString toRegex(QString pattern);
@@ -91,11 +95,14 @@ public:
 	static std::pair<QSharedPointer<DateTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool applyFenced) const override;
 	void fixup(QDateTime &datetime) const override;
+	void compile(TermProgram &program) const override;
+	void compileFixup(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	QDate _date;
 
 	static QString toRegex(QString pattern, bool &hasYear);
@@ -112,11 +119,14 @@ public:
 	static std::pair<QSharedPointer<InvertedTimeTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool applyFenced) const override;
 	void fixup(QDateTime &datetime) const override;
+	void compile(TermProgram &program) const override;
+	void compileFixup(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	QTime _time;
 
 	static QString hourToRegex(QString pattern);
@@ -134,11 +144,14 @@ public:
 	static std::pair<QSharedPointer<MonthDayTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool applyFenced) const override;
 	void fixup(QDateTime &datetime) const override;
+	void compile(TermProgram &program) const override;
+	void compileFixup(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	int _day = 1;
 };
 
@@ -154,11 +167,15 @@ public:
 	void apply(QDateTime &datetime, bool applyFenced) const override;
 	void fixup(QDateTime &datetime) const override;
 	void fixupCleanup(QDateTime &datetime) const override;
+	void compile(TermProgram &program) const override;
+	void compileFixup(TermProgram &program) const override;
+	void compileFixupCleanup(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	int _weekDay = Qt::Monday;
 };
 
@@ -173,11 +190,14 @@ public:
 	static std::pair<QSharedPointer<MonthTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool applyFenced) const override;
 	void fixup(QDateTime &datetime) const override;
+	void compile(TermProgram &program) const override;
+	void compileFixup(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	int _month = 1;
 };
 
@@ -191,11 +211,13 @@ public:
 	Q_INVOKABLE explicit YearTerm(QObject *parent);
 	static std::pair<QSharedPointer<YearTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool applyFenced) const override;
+	void compile(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	int _year = 0;
 };
 
@@ -236,11 +258,13 @@ public:
 	Q_INVOKABLE explicit SequenceTerm(QObject *parent);
 	static std::pair<QSharedPointer<SequenceTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool applyFenced) const override;
+	void compile(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	Sequence _sequence;
 	QMap<QString, int> getSequence() const;
 	void setSequence(const QMap<QString, int> &sequence);
@@ -256,11 +280,13 @@ public:
 	Q_INVOKABLE explicit KeywordTerm(QObject *parent);
 	static std::pair<QSharedPointer<KeywordTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool applyFenced) const override;
+	void compile(TermProgram &program) const override;
 
 	QString describe() const override;
 	static std::pair<QString, QString> syntax(bool asLoop);
 
 private:
+	friend class ::TermConverter;
 	int _days = 0;
 
 };
@@ -275,6 +301,7 @@ public:
 	Q_INVOKABLE explicit LimiterTerm(QObject *parent);
 	static std::pair<QSharedPointer<LimiterTerm>, int> parse(const QStringRef &expression);
 	void apply(QDateTime &datetime, bool applyFenced) const override;
+	void compile(TermProgram &program) const override;
 	QString describe() const override;
 
 	Term limitTerm() const;
@@ -0,0 +1,199 @@
+#include "timezoneservice.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <algorithm>
+#include <chrono>
+using namespace std::chrono;
+
+namespace {
+
+constexpr qint64 EpochJulianDay = 2440588; // 1970-01-01
+constexpr int CachedYearsAhead = 10;
+// outside of this range, the zone is asked directly instead of growing the cache
+constexpr int MinCachedYear = 1900;
+constexpr int MaxCachedYear = 2200;
+
+qint64 toWallMSecs(const QDate &date, const QTime &time)
+{
+	return (date.toJulianDay() - EpochJulianDay) * duration_cast<milliseconds>(hours{24}).count() +
+			time.msecsSinceStartOfDay();
+}
+
+}
+
+TimeZoneService *TimeZoneService::instance()
+{
+	// never deleted, as schedules may use it until the very end
+	static TimeZoneService * const service = []() {
+		auto service = new TimeZoneService{};
+		if(auto app = QCoreApplication::instance()) {
+			service->moveToThread(app->thread());
+			QMetaObject::invokeMethod(service, [service](){
+				service->watchZoneFile();
+			}, Qt::QueuedConnection);
+		}
+		return service;
+	}();
+	return service;
+}
+
+QTimeZone TimeZoneService::systemZone() const
+{
+	QReadLocker locker{&_lock};
+	return _zone;
+}
+
+quint32 TimeZoneService::generation() const
+{
+	return _generation.load();
+}
+
+int TimeZoneService::offsetFromUtc(qint64 msecsSinceEpoch) const
+{
+	{
+		QReadLocker locker{&_lock};
+		if(msecsSinceEpoch >= _cacheBegin && msecsSinceEpoch < _cacheEnd)
+			return lookupOffset(msecsSinceEpoch);
+	}
+
+	QWriteLocker locker{&_lock};
+	const auto utc = QDateTime::fromMSecsSinceEpoch(msecsSinceEpoch, Qt::UTC);
+	const auto year = utc.date().year();
+	if(year < MinCachedYear || year > MaxCachedYear)
+		return _zone.offsetFromUtc(utc);
+	if(msecsSinceEpoch < _cacheBegin || msecsSinceEpoch >= _cacheEnd) // may have been cached by another thread
+		cacheYears(std::min(year, _fromYear), std::max(year, _toYear));
+	return lookupOffset(msecsSinceEpoch);
+}
+
+qint64 TimeZoneService::toMSecsSinceEpoch(const QDate &date, const QTime &time) const
+{
+	return resolveLocal(date, time, nullptr);
+}
+
+qint64 TimeZoneService::toMSecsSinceEpoch(const QDateTime &datetime) const
+{
+	if(datetime.timeSpec() != Qt::LocalTime || !datetime.isValid())
+		return datetime.toMSecsSinceEpoch();
+
+	// the datetime knows which of both times it is, the wall time alone does not
+	auto ambiguous = false;
+	const auto msecs = resolveLocal(datetime.date(), datetime.time(), &ambiguous);
+	return ambiguous ? datetime.toMSecsSinceEpoch() : msecs;
+}
+
+QDateTime TimeZoneService::toLocalTime(const QDate &date, const QTime &time) const
+{
+	if(!date.isValid() || !time.isValid())
+		return QDateTime{date, time, Qt::LocalTime};
+	return QDateTime::fromMSecsSinceEpoch(resolveLocal(date, time, nullptr), Qt::LocalTime);
+}
+
+bool TimeZoneService::watchesSystemZone() const
+{
+	return _watcher != nullptr;
+}
+
+bool TimeZoneService::checkSystemZone()
+{
+	const auto zone = QTimeZone::systemTimeZone();
+	{
+		QWriteLocker locker{&_lock};
+		if(zone == _zone)
+			return false;
+		_zone = zone;
+		const auto year = QDate::currentDate().year();
+		cacheYears(year - 1, year + CachedYearsAhead);
+		_generation.ref();
+	}
+
+	watchZoneFile(); // the zone file is typically replaced, not modified
+	emit systemZoneChanged(zone);
+	return true;
+}
+
+TimeZoneService::TimeZoneService(QObject *parent) :
+	QObject{parent},
+	_zone{QTimeZone::systemTimeZone()}
+{
+	const auto year = QDate::currentDate().year();
+	cacheYears(year - 1, year + CachedYearsAhead);
+}
+
+void TimeZoneService::cacheYears(int fromYear, int toYear) const
+{
+	const QDateTime begin{QDate{fromYear, 1, 1}, QTime{0, 0}, Qt::UTC};
+	const QDateTime end{QDate{toYear + 1, 1, 1}, QTime{0, 0}, Qt::UTC};
+
+	QVector<Transition> transitions;
+	transitions.append({begin.toMSecsSinceEpoch(), _zone.offsetFromUtc(begin)});
+	if(_zone.hasTransitions()) {
+		for(const auto &transition : _zone.transitions(begin, end)) {
+			if(transition.atUtc > begin && transition.atUtc < end)
+				transitions.append({transition.atUtc.toMSecsSinceEpoch(), transition.offsetFromUtc});
+		}
+	}
+
+	_transitions = std::move(transitions);
+	_fromYear = fromYear;
+	_toYear = toYear;
+	_cacheBegin = begin.toMSecsSinceEpoch();
+	_cacheEnd = end.toMSecsSinceEpoch();
+}
+
+int TimeZoneService::lookupOffset(qint64 msecsSinceEpoch) const
+{
+	// last transition that happened before the time
+	auto it = std::upper_bound(_transitions.constBegin(), _transitions.constEnd(), msecsSinceEpoch,
+							   [](qint64 msecs, const Transition &transition) {
+		return msecs < transition.since;
+	});
+	Q_ASSERT(it != _transitions.constBegin());
+	return std::prev(it)->offset;
+}
+
+qint64 TimeZoneService::resolveLocal(const QDate &date, const QTime &time, bool *ambiguous) const
+{
+	// zones never change twice within a day, so the offsets a day before and after are the only candidates
+	const auto day = duration_cast<milliseconds>(hours{24}).count();
+	const auto wall = toWallMSecs(date, time);
+	const auto offsetBefore = offsetFromUtc(wall - day);
+	const auto offsetAfter = offsetFromUtc(wall + day);
+	const auto msecsBefore = wall - offsetBefore * 1000ll;
+	if(offsetBefore == offsetAfter)
+		return msecsBefore;
+
+	const auto msecsAfter = wall - offsetAfter * 1000ll;
+	const auto validBefore = offsetFromUtc(msecsBefore) == offsetBefore;
+	const auto validAfter = offsetFromUtc(msecsAfter) == offsetAfter;
+	if(ambiguous)
+		*ambiguous = validBefore && validAfter;
+	if(validBefore)
+		return msecsBefore; // the earlier one when the time exists twice
+	else if(validAfter)
+		return msecsAfter;
+	else // in the gap: keep the offset of before, which moves the time forward
+		return msecsBefore;
+}
+
+void TimeZoneService::watchZoneFile()
+{
+	// windows and macos only announce zone changes with window messages and the notification center,
+	// which this core only service cannot receive. There, changes are only seen by checkSystemZone calls
+#ifdef Q_OS_LINUX
+	if(!_watcher) {
+		_watcher = new QFileSystemWatcher{this};
+		connect(_watcher, &QFileSystemWatcher::fileChanged,
+				this, &TimeZoneService::checkSystemZone);
+		// zone changes replace the link, which is only seen by the directory
+		connect(_watcher, &QFileSystemWatcher::directoryChanged,
+				this, &TimeZoneService::checkSystemZone);
+		_watcher->addPath(QStringLiteral("/etc"));
+	}
+
+	const auto zoneFile = QStringLiteral("/etc/localtime");
+	if(!_watcher->files().contains(zoneFile) && QFileInfo::exists(zoneFile))
+		_watcher->addPath(zoneFile);
+#endif
+}
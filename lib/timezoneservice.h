@@ -0,0 +1,72 @@
+#ifndef TIMEZONESERVICE_H
+#define TIMEZONESERVICE_H
+
+#include <QAtomicInteger>
+#include <QDateTime>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QTimeZone>
+#include <QVector>
+
+#include "libsyrem_global.h"
+
+class QFileSystemWatcher;
+
+// caches the transitions of the local zone, so local times can be resolved without asking the system each time
+class LIB_SYREM_EXPORT TimeZoneService : public QObject
+{
+	Q_OBJECT
+
+public:
+	static TimeZoneService *instance();
+
+	QTimeZone systemZone() const;
+	// increased with every change of the system zone, so utc times calculated before can be detected
+	quint32 generation() const;
+
+	// offset of the local zone at the given utc time, in seconds
+	int offsetFromUtc(qint64 msecsSinceEpoch) const;
+	// utc time of a local wall time. Times in a gap are moved forward by the gap, like QDateTime does
+	qint64 toMSecsSinceEpoch(const QDate &date, const QTime &time) const;
+	qint64 toMSecsSinceEpoch(const QDateTime &datetime) const;
+	// the result is a Qt::LocalTime, so it keeps following the system zone. The cache only resolves the offset
+	QDateTime toLocalTime(const QDate &date, const QTime &time) const;
+
+	// false where changes of the system zone are not seen by the service itself. Only linux has a watcher,
+	// everywhere else callers must check the zone whenever a change would matter to them
+	bool watchesSystemZone() const;
+
+public slots:
+	// drops the cache and emits systemZoneChanged if the system zone is not the cached one anymore
+	bool checkSystemZone();
+
+signals:
+	void systemZoneChanged(const QTimeZone &zone);
+
+private:
+	struct Transition {
+		qint64 since; // utc msecs
+		int offset; // secs
+	};
+
+	mutable QReadWriteLock _lock;
+	QTimeZone _zone;
+	QAtomicInteger<quint32> _generation {1};
+	// sorted by since, the first entry is valid from the start of the cached range
+	mutable QVector<Transition> _transitions;
+	mutable int _fromYear = 0;
+	mutable int _toYear = -1;
+	mutable qint64 _cacheBegin = 0; // utc msecs
+	mutable qint64 _cacheEnd = 0; // utc msecs, exclusive
+
+	QFileSystemWatcher *_watcher = nullptr;
+
+	explicit TimeZoneService(QObject *parent = nullptr);
+
+	void cacheYears(int fromYear, int toYear) const;
+	int lookupOffset(qint64 msecsSinceEpoch) const;
+	qint64 resolveLocal(const QDate &date, const QTime &time, bool *ambiguous) const;
+	void watchZoneFile();
+};
+
+#endif // TIMEZONESERVICE_H